@@ -0,0 +1,168 @@
+/*
+ * bench.c
+ * Benchmark of the solvers in countdown.c and countdown_clean.c on a fixed corpus of games.
+ *
+ * The corpus are the 15 options of the form {n, n+25, n+50, n+75} from the video and
+ * BENCH_RANDOM_OPTIONS other options picked with a fixed seed. Of every option,
+ * '--games N' games per amount of larges (default: 32) are picked with a fixed seed as well,
+ * so every run (on every machine) computes the same games.
+ * Every game is solved by countdown.c's solution_set and by all engines of countdown_clean.c.
+ *
+ * Building: (both sources have to be next to this file)
+ * gcc -o bench -Ofast -pthread bench.c
+ * ./bench > bench.txt
+ *
+ * Output: one line per solver and amount of larges (0: all of them), tab separated:
+ * solver larges games targets wall_s ns_per_game nodes nodes_per_s
+ * 'targets' is the sum of reachable targets of all games, to see if a change altered the results
+ * (countdown.c's differs, since it only combines two numbers at all if the larger one is a multiple of the smaller one).
+ * Comparing the lines of two runs catches regressions.
+ */
+
+#define _GNU_SOURCE // for countdown_clean.c, but countdown.c includes the headers first
+
+unsigned long long bench_nodes = 0;
+#define COUNT_NODES(n) (bench_nodes += (n))
+
+// both files are complete programs, rename what they have in common
+#define main countdown_main
+#define solve countdown_solve
+#define solution_set countdown_solution_set
+#define iterate_sets countdown_iterate_sets
+#include "countdown.c"
+#undef main
+#undef solve
+#undef solution_set
+#undef iterate_sets
+
+#define main clean_main
+#include "countdown_clean.c"
+#undef main
+
+#define BENCH_RANDOM_OPTIONS 16
+#define BENCH_SEED 0x5eed
+#define NUM_BENCH_OPTIONS (15 + BENCH_RANDOM_OPTIONS)
+#define NUM_SOLVERS 4
+
+const char* solver_names[NUM_SOLVERS] = { "countdown", "clean-search", "clean-subset", "clean-mitm" };
+
+typedef struct game {
+    int val[6];
+} game;
+
+// all games with the given larges: the smalls are every multiset of 6 - n numbers of 1..10, each at most twice
+static void all_games(game* g, int pos, int min, game* out, size_t* ngames) {
+    if (pos == 6) {
+        out[(*ngames)++] = *g;
+        return;
+    }
+    for (int v = min; v <= 10; v++) {
+        if (pos >= 2 && g->val[pos - 1] == v && g->val[pos - 2] == v) continue; // larges are > 10, never equal
+        g->val[pos] = v;
+        all_games(g, pos + 1, v, out, ngames);
+    }
+}
+
+// a number in [0, n), the same on every machine (unlike rand())
+static size_t bench_rand(unsigned int* state, size_t n) {
+    size_t r = 0;
+    for (int i = 0; i < 2; i++) {
+        *state = *state * 1103515245 + 12345;
+        r = r << 15 | ((*state >> 16) & 0x7fff);
+    }
+    return r % n;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// solves a game with solver s, returns the amount of reachable targets
+static int bench_solve(int s, solver* sv, int* sols, const game* g) {
+    if (s == 0) {
+        linkedlist* ll = asll6(g->val[0], g->val[1], g->val[2], g->val[3], g->val[4], g->val[5]);
+        countdown_solution_set(sols, ll);
+        freell(ll);
+        sols[0] = 0;
+        return count_nz_then_clear(sols, 100, 1000);
+    }
+    selected_engine = s == 1 ? ENGINE_SEARCH : s == 2 ? ENGINE_SUBSET : ENGINE_MITM;
+    gamestate set = asgs6(g->val[0], g->val[1], g->val[2], g->val[3], g->val[4], g->val[5]);
+    solve(sv, &set);
+    return solbits_count_then_clear(&sv->sols);
+}
+
+int main(int argc, char* argv[]) {
+    int per_class = 32;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            per_class = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--games N]\n", argv[0]);
+            return 1;
+        }
+    }
+    leaves_init();
+    kernel_select(KERNEL_AVX2);
+
+    // the corpus, by amount of larges
+    size_t options[NUM_BENCH_OPTIONS];
+    unsigned int seed = BENCH_SEED;
+    for (int n = 11; n <= 25; n++) {
+        int larges[4] = { n, n + 25, n + 50, n + 75 };
+        options[n - 11] = option_index(larges);
+    }
+    for (int i = 15; i < NUM_BENCH_OPTIONS; i++)
+        options[i] = bench_rand(&seed, NUM_OPTIONS);
+
+    game* corpus[5];
+    size_t ncorpus[5] = { 0 };
+    game* games = malloc(sizeof(game) * 1452);
+    for (int n = 1; n < 5; n++) {
+        corpus[n] = malloc(sizeof(game) * NUM_BENCH_OPTIONS * per_class);
+        for (int o = 0; o < NUM_BENCH_OPTIONS; o++) {
+            int larges[4], chosen[4];
+            option_larges(options[o], larges);
+            for (int i = 0; i < n; i++) // a different subset of the option's larges for every game class
+                chosen[i] = larges[(o + i) % 4];
+            game g;
+            size_t ngames = 0;
+            memcpy(g.val, chosen, sizeof(int) * n);
+            all_games(&g, n, 1, games, &ngames);
+            for (int i = 0; i < per_class; i++)
+                corpus[n][ncorpus[n]++] = games[bench_rand(&seed, ngames)];
+        }
+    }
+    free(games);
+
+    int* sols = calloc(1024, sizeof(int));
+    printf("# solver\tlarges\tgames\ttargets\twall_s\tns_per_game\tnodes\tnodes_per_s\n");
+    for (int s = 0; s < NUM_SOLVERS; s++) {
+        solver* sv = solver_new(); // every engine starts with an empty cache
+        unsigned long long total_targets = 0, total_nodes = 0, total_games = 0;
+        double total_time = 0;
+        for (int n = 1; n < 5; n++) {
+            unsigned long long targets = 0;
+            bench_nodes = 0;
+            double t = now();
+            for (size_t i = 0; i < ncorpus[n]; i++)
+                targets += bench_solve(s, sv, sols, &corpus[n][i]);
+            t = now() - t;
+            printf("%s\t%d\t%zu\t%llu\t%.6f\t%.0f\t%llu\t%.0f\n", solver_names[s], n, ncorpus[n], targets, t,
+                    t * 1e9 / ncorpus[n], bench_nodes, bench_nodes / t);
+            fflush(stdout);
+            total_targets += targets;
+            total_nodes += bench_nodes;
+            total_games += ncorpus[n];
+            total_time += t;
+        }
+        printf("%s\t0\t%llu\t%llu\t%.6f\t%.0f\t%llu\t%.0f\n", solver_names[s], total_games, total_targets, total_time,
+                total_time * 1e9 / total_games, total_nodes, total_nodes / total_time);
+        solver_free(sv);
+    }
+    free(sols);
+    for (int n = 1; n < 5; n++) free(corpus[n]);
+    return 0;
+}
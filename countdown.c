@@ -54,6 +54,10 @@
 #include <time.h>
 #include <string.h>
 
+#ifndef COUNT_NODES
+#define COUNT_NODES(n) // counts nodes of the search, defined by bench.c
+#endif
+
 const size_t sizeof_int = sizeof(int);
 
 // typedef struct list {
@@ -107,7 +111,14 @@ void printll_dbg(linkedlist* ll) {
     printf("]\n");
 }
 
+#ifdef STATS
+unsigned long long mknode_count = 0; // allocated nodes, printed at the end if built with -DSTATS
+#endif
+
 llnode* mknode(int val) {
+#ifdef STATS
+    mknode_count++;
+#endif
     llnode* node = malloc(sizeof(llnode));
     node->next = node->prev = NULL;
     node->val = val;
@@ -326,6 +337,7 @@ char* solve(int *set, size_t size, int sol) { // not optimized!
 
 void solution_set(int* sols, linkedlist* set) {
     if (set->size < 2) return;
+    COUNT_NODES(1);
     llnode* an = set->first;
     for (int i = 0; i < set->size - 1; i++, an = an->next) {
         llnode* bn = an->next;
@@ -577,5 +589,8 @@ int main(int argc, char *argv[]) {
     iterate_sets();
 
     printf("took %.3fs to compute\n", (clock() - start) * 1.0 / CLOCKS_PER_SEC);
+#ifdef STATS
+    printf("stats: %llu nodes allocated (mknode)\n", mknode_count);
+#endif
     return 0;
 }
@@ -24,8 +24,8 @@
  * all too used to optimizing problems using uncommon algorithms.
  * What i can do though is write some (probably) rather efficient code...
  * Why C? Cuz it's fast!
- * This implementation is purely single-threaded, a 16x speed-up
- * (or more, depending on the amount of cores) could be achieved using multiple threads/processes.
+ * Options are computed by a pool of worker threads (one per core by default, see '--threads'),
+ * splitting the work down to the sets of single subsets of an option's larges.
  * I probably missed some really simple optimizations, too - so don't expect this to run FAST,
  * it's just FAST ENOUGH... probably... hopefully.....
  * 
@@ -34,241 +34,668 @@
  * Building:
  * 
  * [windows]:
- * install gcc using mingw or cygwin (only standard libs (stdlib) required) 
- * from cmd, or powershell, execute:
- * gcc -o countdown.exe -Ofast countdown_clean.c
- * ./countdown
+ * needs a posix system (mmap, fork, poll, unix sockets, cpu affinity), so mingw won't do:
+ * build it in wsl (see linux), or with cygwin's gcc the same way.
  * 
  * [linux/wsl]
  * install gcc using your favourite package manager (apt, pacman, ...)
  * from bash (or whatever shell you prefer), execute:
- * gcc -o countdown -Ofast countdown_clean.c
+ * gcc -o countdown -Ofast -pthread countdown_clean.c
  * ./countdown
  * 
+ * Running:
+ * 
+ * without arguments, all 2,555,190 options of large numbers are computed.
+ * To split the work, pass either '--shard i/N' (the i-th of N parts, 0-based) or '--range start:end'
+ * (option indices, end exclusive); '--larges a,b,c,d' computes a single option.
+ * '--threads N' sets the amount of worker threads (default: one per online cpu),
+ * '--procs N' computes the options in N forked worker processes instead (with '--threads' threads each,
+ * default: 1), so a crashing worker only loses its current range (see Process pool).
+ * '--affinity compact|scatter' pins the workers to cpus, filling numa nodes one by one or in turns (see Placement).
+ * '--engine search|subset|mitm' the algorithm computing the targets of each set (default: subset),
+ * '--cache-mb N' the size of the subset engine's cache per thread (default: 64 MiB, 0 disables it).
+ * '--kernel scalar|avx2' the code the search engine computes the results of all pairs of a set with
+ * (default: avx2 if the cpu supports it).
+ * '--dedup' computes the sets with 1 to 3 larges only once for all options sharing these larges,
+ * which is a lot less work for ranges of many options.
+ * '--checkpoint file' appends every computed option to file; a run restarted with the same file
+ * (and arguments) continues where the last one stopped and prints the same output.
+ * '--store file' also writes the results to a binary file that can be memory-mapped (see Results store),
+ * '--store-games' adds the targets reachable in every single game to it.
+ * '--explain a,b,c,d,e,f target' prints how target is reached from the given numbers, and exits.
+ * '--verify N [--seed S]' checks the engine against a plain search on N random games (see Verification).
+ * '--serve file [--socket path]' answers queries from a results store written by '--store' (see Query server).
+ * '--progress N' reports rates and the time left every N seconds, '--status file' keeps them in file,
+ * SIGUSR1 reports right away (see Progress).
+ * '--stats' prints counters of the work done (nodes, branches, ...), if built with -DSTATS.
+ * Every option prints one result line, so the outputs of all shards can simply be concatenated:
+ * ./countdown --shard 0/16 > part0.txt &
+ * ./countdown --shard 1/16 > part1.txt &
+ * ...
+ * 
  */
 
 /* 
  * Profiling: (note the lack of optimization flags)
- * gcc -o countdown -pg countdown_clean.c
+ * gcc -o countdown -pg -pthread countdown_clean.c
  * gprof countdown gmon.out > analysis.txt
  * 
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // cpu affinity
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 
-typedef struct llnode {
-    void* prev;
-    void* next;
-    int val;
-} llnode;
+#ifndef COUNT_NODES
+#define COUNT_NODES(n) // counts nodes of the search, defined by bench.c
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL
+#endif
+
+/*
+ * Game state:
+ * the numbers still available at some point of a game (at most 6), sorted descending.
+ * States are plain values living on the stack of solution_set, so the search itself
+ * never allocates - every operation just copies the remaining numbers into a new state.
+ */
+#define MAX_SET 6
+
+typedef struct gamestate {
+    int val[MAX_SET];
+    int size;
+} gamestate;
 
-typedef struct linkedlist {
-    llnode* first;
-    llnode* last;
-    size_t size;
-} linkedlist;
+/*
+ * Reachable targets:
+ * one bit per target 100..999. Only whether a target can be reached matters, so a bit
+ * is set once and never counted again. count tracks the amount of set bits, so a search
+ * can stop as soon as every target was reached (the set is 'saturated').
+ */
+#define MIN_TARGET 100
+#define MAX_TARGET 999
+#define NUM_TARGETS (MAX_TARGET - MIN_TARGET + 1)
+#define SOLBITS_WORDS ((NUM_TARGETS + 63) / 64)
+
+/*
+ * Reached targets:
+ * by default only whether a target can be reached is kept (existence mode), so the search stops as
+ * soon as all of them are and skips subtrees that can't reach a new one. With --count-expressions,
+ * exprs counts every expression the search finds per target instead, like countdown.c does
+ * (sols[0], sols[value]). Counting turns off all pruning (as --no-prune), so every order of
+ * operations is counted, not just the ones the pruned search happens to visit.
+ */
+typedef struct solbits {
+    unsigned long long bits[SOLBITS_WORDS];
+    int count;
+    unsigned int known; // the targets below MIN_TARGET + known are all reached (maybe more of them)
+    unsigned long long* exprs; // counting mode: expressions per target, NULL: existence mode
+} solbits;
+
+// marks val as reached (if it is a target), returns 1 once all targets are reached (never while counting)
+static inline int solbits_mark(solbits* sols, int val) {
+    unsigned int idx = val - MIN_TARGET;
+    if (idx >= NUM_TARGETS) return 0;
+    if (sols->exprs != NULL) sols->exprs[idx]++;
+    unsigned long long bit = 1ULL << (idx & 63);
+    if (sols->bits[idx >> 6] & bit) return 0;
+    sols->bits[idx >> 6] |= bit;
+    while (sols->known < NUM_TARGETS && sols->bits[sols->known >> 6] >> (sols->known & 63) & 1)
+        sols->known++;
+    return ++sols->count == NUM_TARGETS && sols->exprs == NULL;
+}
 
-static inline llnode* mknode(int val) {
-    llnode* node = malloc(sizeof(llnode));
-    node->next = node->prev = NULL;
-    node->val = val;
-    return node;
+// marks all targets set in bits, returns 1 once all targets are reached
+static inline int solbits_or(solbits* sols, const unsigned long long* bits) {
+    sols->count = 0;
+    for (int i = 0; i < SOLBITS_WORDS; i++) {
+        sols->bits[i] |= bits[i];
+        sols->count += __builtin_popcountll(sols->bits[i]);
+    }
+    return sols->count == NUM_TARGETS;
 }
 
-unsigned long long count_nz_then_clear(unsigned  long long* set, int start, size_t size) {
+unsigned long long solbits_count_then_clear(solbits* sols) {
     unsigned long long count = 0;
-    for (int i = start; i < size; i++) {
-        if (set[i]) count++;
-        set[i] = 0;
+    for (int i = 0; i < SOLBITS_WORDS; i++) {
+        count += __builtin_popcountll(sols->bits[i]);
+        sols->bits[i] = 0;
     }
+    sols->count = 0;
+    sols->known = 0;
     return count;
 }
 
-void clearll(linkedlist* ll) {
-    for (llnode* node = ll->first; node != NULL; /*node = node->next*/) {
-        llnode* next = node->next;
-        if (node == next) puts("something went terribly wrong!");
-        free(node);
-        node = next;
+// counting mode: the expressions found since the last call
+unsigned long long solbits_exprs_then_clear(solbits* sols) {
+    unsigned long long count = 0;
+    if (sols->exprs == NULL) return 0;
+    for (int i = 0; i < NUM_TARGETS; i++) {
+        count += sols->exprs[i];
+        sols->exprs[i] = 0;
     }
-    ll->size = 0;
+    return count;
 }
 
-void freell(linkedlist* ll) {
-    clearll(ll);
-    free(ll);
+static inline void gs_insert(gamestate* gs, int val) {
+    int i = gs->size++;
+    for (; i > 0 && gs->val[i - 1] < val; i--)
+        gs->val[i] = gs->val[i - 1];
+    gs->val[i] = val;
 }
 
-linkedlist* asll6(int v1, int v2, int v3, int v4, int v5, int v6) {
-    linkedlist* ll = malloc(sizeof(linkedlist));
-    ll->size = 6;
-    llnode* prev;
-    llnode* node = mknode(v1);
-    ll->first = node;
-    ll->last = node;
+gamestate asgs6(int v1, int v2, int v3, int v4, int v5, int v6) {
+    gamestate gs = { .size = 0 };
+    int v[] = { v1, v2, v3, v4, v5, v6 };
+    for (int i = 0; i < 6; i++)
+        gs_insert(&gs, v[i]);
+    return gs;
+}
 
-    node = mknode(v2);
-    if (v1 > v2) {
-        ll->first->next = node;
-        node->prev = ll->first;
-        ll->last = node;
-    } else {
-        ll->last->prev = node;
-        node->next = ll->last;
-        ll->first = node;
-    }
-
-    int v[] = { v3, v4, v5, v6 };
-    for (int i = 0; i < 4; i++) {
-        node = mknode(v[i]);
-        for (prev = ll->first; prev != NULL && prev->val < node->val; prev = prev->next);
-        if (prev == NULL) { // insert as last
-            node->prev = ll->last;
-            ll->last->next = node;
-            ll->last = node;
-        } else if (prev->val < node->val) { // insert as first
-            node->next = ll->first;
-            ll->first->prev = node;
-            ll->first = node;
-        } else { // insert in center
-            llnode* next = prev->next;
-            next->prev = node;
-            node->next = next;
-            prev->next = node;
-            node->prev = prev;
-        }
-    }
-    return ll;
-}
-
-linkedlist* asll(int* vals, size_t size) {
-    linkedlist* ll = malloc(sizeof(linkedlist));
-    ll->size = size;
-    if (size == 0) return ll;
-    ll->first = mknode(vals[0]);
-
-    llnode* prev = ll->first;
-    for (int i = 1; i < size; i++) {
-        llnode* node = mknode(vals[i]);
-        prev->next = node;
-        node->prev = prev;
-        prev = node;
-    }
-    ll->last = prev;
-    return ll;
-}
-
-linkedlist* copyll_rem_ins(linkedlist* ll, int remidx1, int remidx2, int insval) {
-    if (ll->size <= 2) return asll(&insval, 1);
-    linkedlist* out = malloc(sizeof(linkedlist));
-    out->size = ll->size - 1;
-    llnode* llcur = ll->first;
-    llnode* llprev = NULL;
-    llnode* outprev = NULL;
-
-    for (int i = 0; i < ll->size; i++, llcur = llcur->next) {
-        if (i == remidx1 || i == remidx2) continue;
-        if ((llprev == NULL || (llprev->val >= insval)) && llcur->val < insval) { // insert as first or in center
-            llnode* node = mknode(insval);
-            if (outprev == NULL)
-                out->first = node;
-            else {
-                outprev->next = node;
-                node->prev = outprev;
-            }
-            outprev = node;
-        }
+int div_ok(int dividend, int divisor) {
+    return (dividend >= divisor) && ((dividend % divisor) == 0);
+}
+
+/*
+ * Pair kernels:
+ * compute the results of all four operations on up to 16 pairs (a, b), a >= b, at once.
+ * A result is valid if it is a positive integer that fits into an int (products of 4 larges and
+ * 2 smalls don't), so the search doesn't have to check anything but the valid bits anymore.
+ * The avx2 kernel computes 8 pairs per instruction, the scalar kernel is the fallback for cpus without it.
+ */
+enum { OP_ADD, OP_SUB, OP_MUL, OP_DIV, NUM_OPS };
 
-        llnode* node = mknode(llcur->val);
-        if (outprev == NULL)
-            out->first = node;
-        else {
-            outprev->next = node;
-            node->prev = outprev;
+typedef struct expansion {
+    int a[16], b[16];
+    int res[NUM_OPS][16]; // [op][pair]
+    unsigned int valid[NUM_OPS]; // bit p: res[op][p] is valid
+} expansion;
+
+void expand_scalar(expansion* ex, int n) {
+    memset(ex->valid, 0, sizeof(ex->valid));
+    for (int p = 0; p < n; p++) {
+        int a = ex->a[p], b = ex->b[p];
+        if (!__builtin_add_overflow(a, b, &ex->res[OP_ADD][p])) ex->valid[OP_ADD] |= 1 << p;
+        if ((ex->res[OP_SUB][p] = a - b) > 0) ex->valid[OP_SUB] |= 1 << p;
+        if (!__builtin_mul_overflow(a, b, &ex->res[OP_MUL][p])) ex->valid[OP_MUL] |= 1 << p;
+        if (div_ok(a, b)) {
+            ex->res[OP_DIV][p] = a / b;
+            ex->valid[OP_DIV] |= 1 << p;
         }
-        outprev = node;
-        llprev = llcur;
     }
+}
+
+#ifdef HAVE_AVX2_KERNEL
+__attribute__((target("avx2")))
+void expand_avx2(expansion* ex, int n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    memset(ex->valid, 0, sizeof(ex->valid));
+    for (int h = 0; h < n; h += 8) {
+        __m256i used = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - h), lanes);
+        __m256i a = _mm256_loadu_si256((const __m256i*)&ex->a[h]);
+        __m256i b = _mm256_blendv_epi8(_mm256_set1_epi32(1), _mm256_loadu_si256((const __m256i*)&ex->b[h]), used); // no garbage in unused lanes
+
+        // addition: both operands are positive, so it overflowed if the sign flipped
+        __m256i sum = _mm256_add_epi32(a, b);
+        __m256i sum_ok = _mm256_cmpgt_epi32(sum, zero);
+
+        // subtraction
+        __m256i diff = _mm256_sub_epi32(a, b);
+        __m256i diff_ok = _mm256_cmpgt_epi32(diff, zero);
+
+        // multiplication: full 64 bit products of even and odd lanes, fits if the upper 33 bits are 0
+        __m256i prod = _mm256_mullo_epi32(a, b);
+        __m256i even = _mm256_mul_epu32(a, b);
+        __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+        __m256i hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 31), _mm256_slli_epi64(_mm256_srli_epi64(odd, 31), 32), 0xaa);
+        __m256i prod_ok = _mm256_cmpeq_epi32(hi, zero);
+
+        // division: a / b in double precision is exact if b divides a, which the product checks
+        __m128i q_lo = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)),
+                _mm256_cvtepi32_pd(_mm256_castsi256_si128(b))));
+        __m128i q_hi = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)),
+                _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1))));
+        __m256i quot = _mm256_inserti128_si256(_mm256_castsi128_si256(q_lo), q_hi, 1);
+        __m256i quot_ok = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_mullo_epi32(quot, b), a), _mm256_cmpgt_epi32(quot, zero));
+
+        _mm256_storeu_si256((__m256i*)&ex->res[OP_ADD][h], sum);
+        _mm256_storeu_si256((__m256i*)&ex->res[OP_SUB][h], diff);
+        _mm256_storeu_si256((__m256i*)&ex->res[OP_MUL][h], prod);
+        _mm256_storeu_si256((__m256i*)&ex->res[OP_DIV][h], quot);
+        unsigned int m = _mm256_movemask_ps(_mm256_castsi256_ps(used));
+        ex->valid[OP_ADD] |= (_mm256_movemask_ps(_mm256_castsi256_ps(sum_ok)) & m) << h;
+        ex->valid[OP_SUB] |= (_mm256_movemask_ps(_mm256_castsi256_ps(diff_ok)) & m) << h;
+        ex->valid[OP_MUL] |= (_mm256_movemask_ps(_mm256_castsi256_ps(prod_ok)) & m) << h;
+        ex->valid[OP_DIV] |= (_mm256_movemask_ps(_mm256_castsi256_ps(quot_ok)) & m) << h;
+    }
+}
+#endif
 
-    if (outprev->val >= insval) { // insert as last
-        llnode* node = mknode(insval);
-        outprev->next = node;
-        node->prev = outprev;
-        outprev = node;
+typedef enum kernel { KERNEL_SCALAR, KERNEL_AVX2, NUM_KERNELS } kernel;
+const char* kernel_names[] = { "scalar", "avx2" };
+void (*expand_pairs)(expansion* ex, int n) = expand_scalar;
+
+// selects a kernel, returns 0 if the cpu doesn't support it
+int kernel_select(kernel k) {
+    switch (k) {
+    case KERNEL_SCALAR: expand_pairs = expand_scalar; return 1;
+#ifdef HAVE_AVX2_KERNEL
+    case KERNEL_AVX2:
+        if (!__builtin_cpu_supports("avx2")) return 0;
+        expand_pairs = expand_avx2;
+        return 1;
+#endif
+    default: return 0;
     }
-    out->last = outprev;
-    return out;
 }
 
-int div_ok(int dividend, int divisor) {
-    return (dividend >= divisor) && ((dividend % divisor) == 0);
+kernel kernel_selected() {
+    return expand_pairs == expand_scalar ? KERNEL_SCALAR : KERNEL_AVX2;
 }
 
-void solution_set(unsigned long long* sols, linkedlist* set) {
-    if (set->size < 2) return;
-    llnode* an = set->first;
-    for (int i = 0; i < set->size - 1; i++, an = an->next) {
-        llnode* bn = an->next;
-        for (int j = i + 1; j < set->size; j++, bn = bn->next) {
-            int a = an->val;
-            int b = bn->val;
-
-            // addition
-            int sum = a + b; // guaranteed to be > 0
-            if (sum > 99 && sum < 1000) {
-                sols[0]++;
-                sols[sum]++;
-            }
-            if (set->size > 2) {
-                linkedlist* mut = copyll_rem_ins(set, i, j, sum);
-                solution_set(sols, mut);
-                freell(mut);
-            }
+/*
+ * Statistics (--stats, only if compiled with -DSTATS):
+ * counters of the work the engines do, kept per thread and amount of larges of the game being solved
+ * (set by iterate_games) and added up when a worker is done. They are printed per amount of larges.
+ * Without STATS, STAT(...) compiles to nothing, so the counters cost nothing in normal builds.
+ * Sizes are the amount of numbers in a state (search) or sub-multiset (subset engine).
+ * Leaves of 2 numbers skip results that can't be targets, so their branches aren't counted.
+ */
+#ifdef STATS
+typedef struct stats {
+    unsigned long long nodes[MAX_SET + 1]; // search: states, subset: splits combined, by size
+    unsigned long long targets[MAX_SET + 1]; // targets first reached by an operation on a state of that size
+    unsigned long long tt_hits[MAX_SET + 1]; // search: states skipped since they were searched before, by size
+    unsigned long long known[MAX_SET + 1]; // search: states skipped since they can't reach a new target, by size
+    unsigned long long branches[NUM_OPS]; // valid results, by operation
+    unsigned long long pruned[NUM_OPS]; // of those, not searched any further
+    unsigned long long div_rejected; // pairs that can't be divided (not a multiple)
+    unsigned long long allocs; // heap allocations (buffers growing, cache entries)
+} stats;
 
-            // subtraction
-            int diff = a - b;
-            if (diff > 0) {
-                if (diff > 99 && diff < 1000) {
-                    sols[0]++;
-                    sols[diff]++;
-                }
-                if (set->size > 2) {
-                    linkedlist* mut = copyll_rem_ins(set, i, j, diff);
-                    solution_set(sols, mut);
-                    freell(mut);
-                }
+__thread stats tstats_by[5]; // [larges]
+__thread int tstats_larges;
+#define tstats tstats_by[tstats_larges]
+stats total_stats[5];
+pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// adds up the counters of all amounts of larges (stats[5] each)
+void stats_add(stats* to, const stats* from) {
+    unsigned long long* t = (unsigned long long*)to;
+    const unsigned long long* f = (const unsigned long long*)from;
+    for (size_t i = 0; i < 5 * sizeof(stats) / sizeof(unsigned long long); i++) t[i] += f[i];
+}
+
+void stats_merge() {
+    pthread_mutex_lock(&stats_lock);
+    stats_add(total_stats, tstats_by);
+    pthread_mutex_unlock(&stats_lock);
+    memset(tstats_by, 0, sizeof(tstats_by));
+}
+
+void stats_print() {
+    const char* ops = "+-*/";
+    struct rusage ru, children;
+    for (int l = 0; l < 5; l++) {
+        const stats* st = &total_stats[l];
+        const unsigned long long* c = (const unsigned long long*)st;
+        size_t k = 0;
+        while (k < sizeof(stats) / sizeof(unsigned long long) && c[k] == 0) k++;
+        if (k == sizeof(stats) / sizeof(unsigned long long)) continue; // no games with l larges
+        printf("stats (%d larges): nodes by size:", l);
+        for (int n = MAX_SET; n > 1; n--) printf(" %d: %llu", n, st->nodes[n]);
+        printf("\nstats (%d larges): states skipped by the transposition table:", l);
+        for (int n = MAX_SET - 1; n > 3; n--) printf(" %d: %llu", n, st->tt_hits[n]);
+        printf("\nstats (%d larges): states skipped since they can't reach a new target:", l);
+        for (int n = MAX_SET - 1; n > 2; n--) printf(" %d: %llu", n, st->known[n]);
+        printf("\nstats (%d larges): targets first reached by size:", l);
+        for (int n = MAX_SET; n > 1; n--) printf(" %d: %llu", n, st->targets[n]);
+        printf("\nstats (%d larges): branches by operation:", l);
+        for (int op = 0; op < NUM_OPS; op++) printf(" %c %llu (%llu pruned)", ops[op], st->branches[op], st->pruned[op]);
+        printf("\nstats (%d larges): %llu divisions rejected, %llu allocations\n", l, st->div_rejected, st->allocs);
+    }
+    getrusage(RUSAGE_SELF, &ru);
+    getrusage(RUSAGE_CHILDREN, &children); // --procs workers, once they are waited for
+    if (children.ru_maxrss > 0) printf("stats: peak rss %ld KiB (largest worker process: %ld KiB)\n", ru.ru_maxrss, children.ru_maxrss);
+    else printf("stats: peak rss %ld KiB\n", ru.ru_maxrss);
+}
+
+#define STAT(x) (x)
+#define STATS_BUILD 1
+#else
+#define STAT(x)
+#define STATS_BUILD 0
+#endif
+
+// solbits_mark, counting new targets by the size of the state they were reached from
+static inline int solbits_mark_at(solbits* sols, int val, int size) {
+#ifdef STATS
+    int count = sols->count, full = solbits_mark(sols, val);
+    tstats.targets[size] += sols->count - count;
+    return full;
+#else
+    return solbits_mark(sols, val);
+#endif
+}
+
+/*
+ * Pruning:
+ * branches that can't reach any target the rest of the search doesn't reach anyway are skipped.
+ * - pairs with the same values as an earlier pair (sets containing a number twice)
+ * - results equal to one of their operands (x * 1, x / 1, 2x - x, x*x / x): the remaining
+ *   numbers are a subset of the current ones, so the search already covers them.
+ *   The result itself is still marked, as it may be a target that is part of the set (e.g. 100 * 1).
+ * - in existence mode, states whose numbers can't grow past the targets reached so far: combining a and b
+ *   never gives more than max(a, 2) * max(b, 2), so nothing reachable exceeds the product of max(v, 2).
+ */
+int search_prune = 1;
+
+static inline int prune_result(int op, int res, int b) {
+    return search_prune && (res == b || ((op == OP_MUL || op == OP_DIV) && b == 1));
+}
+
+// 1 if every target reachable from the state of n numbers (descending) is reached already
+static inline int prune_known(const solbits* sols, const int* val, int n) {
+    if (!search_prune) return 0;
+    long long bound = 1;
+    for (int i = 0; i < n; i++) {
+        bound *= val[i] > 2 ? val[i] : 2;
+        if (bound >= MIN_TARGET + sols->known) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Transposition table:
+ * within a game, the search reaches the same state along different orders of operations
+ * (25 + 50, then 3 * 6 and 3 * 6, then 25 + 50 both lead to 100 75 75 18). All targets reachable
+ * from a state are marked the first time it is searched, so every later time it is skipped.
+ * States of 5 and 4 numbers are keyed by their sorted numbers, packed into 128 bits (25 and 31 bits
+ * per number, states with larger numbers aren't looked up). The table belongs to the thread (allocated
+ * by the thread itself on its first game, so it is on the thread's numa node, see Placement) and is
+ * emptied for every game by advancing its stamp: entries of an older stamp are free.
+ * Once half of it is used, further states of the game aren't added. Off with --no-prune.
+ */
+#define TT_BITS 12
+
+typedef struct tt_entry {
+    __uint128_t key;
+    unsigned int stamp;
+} tt_entry;
+
+__thread tt_entry* tt;
+__thread unsigned int tt_stamp, tt_used;
+
+// empties the table, for the next game
+static inline void tt_clear() {
+    if (tt == NULL) { // first game of this thread
+        tt = calloc(1 << TT_BITS, sizeof(tt_entry));
+        tt_stamp = 0;
+    }
+    if (++tt_stamp == 0) { // stamps wrapped around, really clear
+        memset(tt, 0, sizeof(tt_entry) << TT_BITS);
+        tt_stamp = 1;
+    }
+    tt_used = 0;
+}
+
+// frees the table of the calling thread (workers, before they exit)
+void tt_free() {
+    free(tt);
+    tt = NULL;
+}
+
+// returns 1 if the state of n numbers was searched before (during this game), else adds it
+static inline int tt_seen(const int* val, int n) {
+    const int bits = n == 5 ? 25 : 31;
+    __uint128_t key = n;
+    for (int i = 0; i < n; i++) {
+        if ((unsigned int)val[i] >> bits) return 0;
+        key = key << bits | (unsigned int)val[i];
+    }
+    unsigned long long h = ((unsigned long long)key ^ (unsigned long long)(key >> 64) * 0x9e3779b97f4a7c15ULL) * 0xff51afd7ed558ccdULL;
+    for (unsigned int i = h >> (64 - TT_BITS);; i = (i + 1) & ((1 << TT_BITS) - 1)) {
+        if (tt[i].stamp != tt_stamp) {
+            if (tt_used >= 1 << (TT_BITS - 1)) return 0;
+            tt[i].key = key;
+            tt[i].stamp = tt_stamp;
+            tt_used++;
+            return 0;
+        }
+        if (tt[i].key == key) return 1;
+    }
+}
+
+/*
+ * Leaves:
+ * states of 2 and 3 numbers are nearly all nodes of the search (9 in 10 for 6 numbers), so they are
+ * solved by straight-line code, without recursion, copies of the state or the pair kernels.
+ * - 2 numbers: only their results themselves can be targets, so only the ones that can be in range
+ *   are computed (a sum or product of a number > MAX_TARGET never is).
+ * - 3 numbers: the results of each of the 3 pairs, each one combined with the third number as a leaf.
+ * Two tables save the work on small numbers: small_results holds the (distinct) results of every pair of
+ * numbers 1..SMALL_MAX, small_div tests divisibility by (and divides by) 1..SMALL_MAX with a multiplication.
+ */
+#define SMALL_MAX 10
+
+typedef struct small_pair {
+    int n;
+    int res[NUM_OPS];
+} small_pair;
+
+typedef struct small_divisor {
+    unsigned int shift, inv, lim; // divisor = d << shift, d odd: x is a multiple if (x >> shift) * inv <= lim (mod 2^32)
+} small_divisor;
+
+small_pair small_results[SMALL_MAX + 1][SMALL_MAX + 1]; // [a][b], a >= b
+small_divisor small_div[SMALL_MAX + 1];
+
+void leaves_init() {
+    for (unsigned int d = 1; d <= SMALL_MAX; d++) {
+        small_divisor* sd = &small_div[d];
+        sd->shift = __builtin_ctz(d);
+        unsigned int odd = d >> sd->shift, inv = odd;
+        for (int i = 0; i < 5; i++) inv *= 2 - odd * inv; // newton's method, inverse mod 2^32
+        sd->inv = inv;
+        sd->lim = 0xffffffffu / odd;
+    }
+    for (int a = 1; a <= SMALL_MAX; a++)
+        for (int b = 1; b <= a; b++) {
+            small_pair* sp = &small_results[a][b];
+            int res[NUM_OPS] = { a + b, a - b, a * b, a % b == 0 ? a / b : 0 };
+            sp->n = 0;
+            for (int op = 0; op < NUM_OPS; op++) {
+                int dup = res[op] <= 0;
+                for (int k = 0; k < sp->n && search_prune; k++) dup |= sp->res[k] == res[op]; // same subtree twice
+                if (!dup) sp->res[sp->n++] = res[op];
             }
+        }
+}
+
+// returns 1 if a is a multiple of b (a >= b), storing a / b in *quot
+static inline int divides(unsigned int a, unsigned int b, int* quot) {
+    if (b <= SMALL_MAX) {
+        const small_divisor* sd = &small_div[b];
+        unsigned int q = (a >> sd->shift) * sd->inv;
+        if (a & ((1u << sd->shift) - 1) || q > sd->lim) return 0;
+        *quot = q;
+        return 1;
+    }
+    if (a % b) return 0;
+    *quot = a / b;
+    return 1;
+}
+
+// a state of 2 numbers, a >= b
+static inline int leaf2(solbits* sols, int a, int b) {
+    int quot;
+    COUNT_NODES(1);
+    STAT(tstats.nodes[2]++);
+    if (a <= MAX_TARGET) {
+        if (solbits_mark_at(sols, a + b, 2)) return 1;
+        if (solbits_mark_at(sols, a * b, 2)) return 1;
+    }
+    if (solbits_mark_at(sols, a - b, 2)) return 1;
+    if ((long long)b * MIN_TARGET <= a) {
+        if (divides(a, b, &quot)) return solbits_mark_at(sols, quot, 2);
+        STAT(tstats.div_rejected++);
+    }
+    return 0;
+}
+
+// the pair a >= b of a state of 3 numbers, the third one being c
+static inline int leaf3_pair(solbits* sols, int a, int b, int c) {
+    int res[NUM_OPS], n = 0, quot;
+    if (a <= SMALL_MAX) {
+        const small_pair* sp = &small_results[a][b];
+        for (n = 0; n < sp->n; n++) res[n] = sp->res[n];
+    } else {
+        if (!__builtin_add_overflow(a, b, &res[n])) n++;
+        if (a > b) res[n++] = a - b;
+        if (!__builtin_mul_overflow(a, b, &res[n])) n++;
+        if (divides(a, b, &quot)) res[n++] = quot;
+        else STAT(tstats.div_rejected++);
+    }
+    for (int k = 0; k < n; k++) {
+        int r = res[k];
+        if (solbits_mark_at(sols, r, 3)) return 1;
+        if (search_prune && (r == a || r == b)) continue; // x * 1, x / 1, 2x - x, x*x / x
+        if (r > c ? leaf2(sols, r, c) : leaf2(sols, c, r)) return 1;
+    }
+    return 0;
+}
+
+// a state of 3 numbers, a >= b >= c, pairs in the same order as solution_set
+// (not inlined: the unrolled solution_set4 calls it from 72 places, which would flood the instruction cache)
+static __attribute__((noinline)) int leaf3(solbits* sols, int a, int b, int c) {
+    const int val[3] = { a, b, c };
+    if (prune_known(sols, val, 3)) {
+        STAT(tstats.known[3]++);
+        return 0;
+    }
+    COUNT_NODES(1);
+    STAT(tstats.nodes[3]++);
+    if (leaf3_pair(sols, a, b, c)) return 1;
+    if (!(search_prune && b == c) && leaf3_pair(sols, a, c, b)) return 1; // same pair as (a, b) otherwise
+    if (!(search_prune && a == b) && leaf3_pair(sols, b, c, a)) return 1; // same pair as (a, c) otherwise
+    return 0;
+}
+
+/*
+ * Specialized solvers:
+ * solution_set_n searches a state of exactly n numbers (sorted descending). It is always inlined
+ * into solution_set6, solution_set5 and solution_set4 with n as a constant, so each of them is compiled
+ * for its own size: the pair loops are unrolled over constant pair tables, the states are arrays of
+ * fixed size and every check on n is decided at compile time. The children of states of 4 numbers are leaves.
+ */
+#define NUM_PAIRS(n) ((n) * ((n) - 1) / 2)
 
-            // multiplication
-            int prod = a * b; // guaranteed to be > 0
-            if (prod > 99 && prod < 1000) {
-                sols[0]++;
-                sols[prod]++;
+// pairs (i, j), i < j, of a state of n numbers, in the order the search visits them
+static const unsigned char pair_i[MAX_SET + 1][NUM_PAIRS(MAX_SET)] = {
+    [4] = { 0, 0, 0, 1, 1, 2 },
+    [5] = { 0, 0, 0, 0, 1, 1, 1, 2, 2, 3 },
+    [6] = { 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 3, 3, 4 },
+};
+static const unsigned char pair_j[MAX_SET + 1][NUM_PAIRS(MAX_SET)] = {
+    [4] = { 1, 2, 3, 2, 3, 3 },
+    [5] = { 1, 2, 3, 4, 2, 3, 4, 3, 4, 4 },
+    [6] = { 1, 2, 3, 4, 5, 2, 3, 4, 5, 3, 4, 5, 4, 5, 5 },
+};
+static const unsigned char pair_rest[NUM_PAIRS(4)][2] = { { 2, 3 }, { 1, 3 }, { 1, 2 }, { 0, 3 }, { 0, 2 }, { 0, 1 } }; // the other two of 4 numbers
+
+static int solution_set5(solbits* sols, const int* val);
+static int solution_set4(solbits* sols, const int* val);
+
+static inline __attribute__((always_inline)) int solution_set_n(solbits* sols, const int* val, const int n) {
+    expansion ex;
+    if (n < MAX_SET && prune_known(sols, val, n)) {
+        STAT(tstats.known[n]++);
+        return 0;
+    }
+    if (n < MAX_SET && search_prune && tt_seen(val, n)) {
+        STAT(tstats.tt_hits[n]++);
+        return 0;
+    }
+    COUNT_NODES(1);
+    STAT(tstats.nodes[n]++);
+#pragma GCC unroll 15
+    for (int p = 0; p < NUM_PAIRS(n); p++) {
+        ex.a[p] = val[pair_i[n][p]];
+        ex.b[p] = val[pair_j[n][p]];
+    }
+    expand_pairs(&ex, NUM_PAIRS(n));
+#pragma GCC unroll 15
+    for (int p = 0; p < NUM_PAIRS(n); p++) {
+        const int i = pair_i[n][p], j = pair_j[n][p];
+        if (search_prune && i > 0 && val[i] == val[i - 1]) continue; // same pairs as i - 1
+        if (search_prune && j > i + 1 && val[j] == val[j - 1]) continue; // same pair as (i, j - 1)
+        STAT(tstats.div_rejected += !(ex.valid[OP_DIV] & (1 << p)));
+        for (int op = 0; op < NUM_OPS; op++) {
+            if (!(ex.valid[op] & (1 << p))) continue;
+            int res = ex.res[op][p];
+            STAT(tstats.branches[op]++);
+            if (solbits_mark_at(sols, res, n)) return 1;
+            if (prune_result(op, res, val[j])) {
+                STAT(tstats.pruned[op]++);
+                continue;
             }
-            if (set->size > 2) {
-                linkedlist* mut = copyll_rem_ins(set, i, j, prod);
-                solution_set(sols, mut);
-                freell(mut);
+            if (n == 4) { // the other two numbers and res, straight into the leaves
+                int u = val[pair_rest[p][0]], v = val[pair_rest[p][1]];
+                if (res >= u ? leaf3(sols, res, u, v) : res >= v ? leaf3(sols, u, res, v) : leaf3(sols, u, v, res)) return 1;
+                continue;
             }
-
-            // division
-            if (div_ok(a, b)) {
-                int div = a / b;
-                if (div > 99 && div < 1000) {
-                    sols[0]++;
-                    sols[div]++;
-                }
-                if (set->size > 2) {
-                    linkedlist* mut = copyll_rem_ins(set, i, j, div);
-                    solution_set(sols, mut);
-                    freell(mut);
+            int mut[MAX_SET - 1], m = 0, ins = 0; // the other numbers, res inserted at its sorted position
+#pragma GCC unroll 6
+            for (int k = 0; k < n; k++) {
+                if (k == i || k == j) continue;
+                if (!ins && val[k] < res) {
+                    mut[m++] = res;
+                    ins = 1;
                 }
+                mut[m++] = val[k];
             }
+            if (!ins) mut[m++] = res;
+            if (n == 6 ? solution_set5(sols, mut) : solution_set4(sols, mut)) return 1;
         }
     }
+    return 0;
+}
+
+#define SPECIALIZE(n) static int solution_set##n(solbits* sols, const int* val) { return solution_set_n(sols, val, n); }
+SPECIALIZE(6)
+SPECIALIZE(5)
+SPECIALIZE(4)
+
+// marks all targets reachable from set, returns 1 if the search was stopped early since all of them were reached
+int solution_set(solbits* sols, const gamestate* set) {
+    tt_clear();
+    switch (set->size) {
+    case 6: return solution_set6(sols, set->val);
+    case 5: return solution_set5(sols, set->val);
+    case 4: return solution_set4(sols, set->val);
+    case 3: return leaf3(sols, set->val[0], set->val[1], set->val[2]);
+    case 2: return leaf2(sols, set->val[0], set->val[1]);
+    default: return 0;
+    }
 }
 
 // void solution_set(unsigned long long* sols, linkedlist* set) {
@@ -335,208 +762,2509 @@ void solution_set(unsigned long long* sols, linkedlist* set) {
 //     }
 // }
 
-void iterate_sets() {
-    int valid_smalls[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
-    unsigned long long* solset = malloc(sizeof(unsigned long long) * 1024);
-
-    unsigned long long set_0_large_count, set_1_large_count = 0, set_2_large_count = 0,
-            set_3_large_count = 0, set_4_large_count = 0;
-    unsigned long long sol_0_large_count, sol_1_large_count = 0, sol_2_large_count = 0,
-            sol_3_large_count = 0, sol_4_large_count = 0;
-
-    int larges[] = { 25, 50, 75, 100 }; // TODO iter
-
-    // // 0 "larges"
-    // // 3 pairs
-    // for (int i = 1; i < 11; i++)
-    //     for (int j = i + 1; j < 11; j++)
-    //         for (int k = j + 1; k < 11; k++) {
-    //             int set[] = { i, i, j, j, k, k };
-    //             solution_set(solset, set, 6);
-    //             set_0_large_count++;
-    //             sol_0_large_count += solset->size;
-    //             solset->size = 0;
-    //         }
-    // // 2 pairs
-    // for (int i = 1; i < 11; i++)
-    //     for (int j = i + 1; j < 11; j++)
-    //         for (int k = 1; k < 11; k++) {
-    //             if (k == i || k == j) continue;
-    //             for (int l = k + 1; l < 11; l++) {
-    //                 if (l == i || l == j) continue;
-    //                 int set[] = { i, i, j, j, k, l };
-    //                 solution_set(solset, set, 6);
-    //                 set_0_large_count++;
-    //                 sol_0_large_count += solset->size;
-    //                 solset->size = 0;
-    //             }
-    //         }
-    // // 1 pair
-    // for (int i = 1; i < 11; i++) {
-    //     int *mut = arr_remove_val(valid_smalls, 10, 9, i);
-    //     for (int j = 0; j < 6; j++) 
-    //         for (int k = j + 1; k < 7; k++)
-    //             for (int l = k + 1; l < 8; l++)
-    //                 for (int m = l + 1; m < 9; m++) {
-    //                     int set[] = { i, i, mut[j], mut[k], mut[l], mut[m] };
-    //                     solution_set(solset, set, 6);
-    //                     set_0_large_count++;
-    //                     sol_0_large_count += solset->size;
-    //                     solset->size = 0;
-    //                 }
-    // }
-    // // 0 pairs
-    // for (int i = 1; i < 6; i++)
-    //     for (int j = i + 1; j < 7; j++)
-    //         for (int k = j + 1; k < 8; k++)
-    //             for (int l = k + 1; l < 9; l++)
-    //                 for (int m = l + 1; m < 10; m++)
-    //                     for (int n = m + 1; n < 11; n++) {
-    //                         int set[] = { i, j, k, l, m, n };
-    //                         solution_set(solset, set, 6);
-    //                         set_0_large_count++;
-    //                         sol_0_large_count += solset->size;
-    //                         solset->size = 0;
-    //                     }
-    printf("20%% (computed sets with 0 larges)\n");
-    
-    // 1 "large"
-    for (int L = 0; L < 4; L++) {
-        // 2 pairs
-        for (int i = 1; i < 10; i++)
-            for (int j = i + 1; j < 11; j++)
-                for (int k = 1; k < 11; k++) {
-                    if (k == i || k == j) continue;
-                    linkedlist* set = asll6(larges[L], i, i, j, j, k);
-                    solution_set(solset, set);
-                    set_1_large_count++;
-                    sol_1_large_count += count_nz_then_clear(solset, 99, 1000);
-                }
-        // 1 pair
-        for (int i = 1; i < 11; i++)
-            for (int j = 1; j < 9; j++) {
-                if (j == i) continue;
-                for (int k = j + 1; k < 10; k++) {
-                    if (k == i) continue;
-                    for (int l = k + 1; l < 11; l++) {
-                        if (l == i) continue;
-                        linkedlist* set = asll6(larges[L], i, i, j, k, l);
-                        solution_set(solset, set);
-                        set_1_large_count++;
-                        sol_1_large_count += count_nz_then_clear(solset, 99, 1000);
-                    }
-                }
+/*
+ * Cache:
+ * values reachable from sub-multisets, kept across sets (and options). The numbers
+ * of a sub-multiset are sorted, so they pack into a unique 64 bit key (7 bits per number
+ * plus the amount of numbers). Every thread owns a cache, bounded by max_bytes; when it
+ * is full, entries are evicted in clock order (entries used since the hand last passed
+ * them get a second chance). Entries used by the set currently being computed are never evicted.
+ */
+#define CACHE_MIN_SIZE 2 // single numbers don't need to be computed
+
+typedef struct cache_entry {
+    unsigned long long key; // 0: empty slot
+    int* val;
+    int size;
+    unsigned long long targets[SOLBITS_WORDS]; // targets among val
+    unsigned int used; // stamp of the set that last used this entry
+    int ref;
+} cache_entry;
+
+typedef struct cache {
+    cache_entry* slots;
+    size_t mask, count, hand; // mask: amount of slots - 1
+    size_t bytes, max_bytes;
+    unsigned int stamp;
+    unsigned long long hits, misses, evictions;
+} cache;
+
+size_t cache_max_bytes = 64 << 20; // per thread, 0 disables caching
+
+// numbers must be < 1 << 7 (games of the challenge are, --explain may not: those aren't cached)
+static inline unsigned long long cache_key(const int* vals, int size) {
+    unsigned long long key = size;
+    for (int i = 0; i < size; i++)
+        key = (key << 7) | vals[i];
+    return key;
+}
+
+static inline size_t cache_home(const cache* c, unsigned long long key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key & c->mask;
+}
+
+void cache_init(cache* c, size_t max_bytes) {
+    memset(c, 0, sizeof(cache));
+    size_t slots = 1024; // the slots take at most a quarter of max_bytes
+    while (slots * 2 * sizeof(cache_entry) * 4 <= max_bytes) slots *= 2;
+    c->slots = calloc(slots, sizeof(cache_entry));
+    c->mask = slots - 1;
+    c->max_bytes = max_bytes;
+    c->bytes = slots * sizeof(cache_entry);
+}
+
+void cache_free(cache* c) {
+    for (size_t i = 0; c->slots != NULL && i <= c->mask; i++)
+        free(c->slots[i].val);
+    free(c->slots);
+    memset(c, 0, sizeof(cache));
+}
+
+static void cache_remove(cache* c, size_t i) {
+    c->bytes -= sizeof(int) * c->slots[i].size;
+    c->count--;
+    free(c->slots[i].val);
+    // backward shift deletion: move following entries of the probe sequence into the hole
+    for (size_t j = (i + 1) & c->mask; c->slots[j].key != 0; j = (j + 1) & c->mask) {
+        size_t home = cache_home(c, c->slots[j].key);
+        if (((j - home) & c->mask) >= ((j - i) & c->mask)) {
+            c->slots[i] = c->slots[j];
+            i = j;
+        }
+    }
+    c->slots[i].key = 0;
+    c->slots[i].val = NULL;
+}
+
+static void cache_evict(cache* c, size_t need) {
+    for (size_t steps = 0; (c->bytes + need > c->max_bytes || c->count * 2 > c->mask) && steps < 2 * (c->mask + 1); steps++) {
+        cache_entry* e = &c->slots[c->hand];
+        if (e->key == 0 || e->used == c->stamp) {
+            c->hand = (c->hand + 1) & c->mask;
+        } else if (e->ref) {
+            e->ref = 0;
+            c->hand = (c->hand + 1) & c->mask;
+        } else {
+            cache_remove(c, c->hand); // the hand stays, an entry may have been moved here
+            c->evictions++;
+        }
+    }
+}
+
+// returns the entry with the given key, or NULL
+static inline cache_entry* cache_get(cache* c, unsigned long long key) {
+    for (size_t i = cache_home(c, key); c->slots[i].key != 0; i = (i + 1) & c->mask)
+        if (c->slots[i].key == key) {
+            c->slots[i].used = c->stamp;
+            c->slots[i].ref = 1;
+            c->hits++;
+            return &c->slots[i];
+        }
+    c->misses++;
+    return NULL;
+}
+
+// stores a copy of vals, returns the copy (or NULL if it doesn't fit)
+static const int* cache_put(cache* c, unsigned long long key, const int* vals, int size, const unsigned long long* targets) {
+    size_t bytes = sizeof(int) * size;
+    cache_evict(c, bytes);
+    if (c->bytes + bytes > c->max_bytes || c->count * 2 > c->mask) return NULL;
+    size_t i = cache_home(c, key);
+    while (c->slots[i].key != 0) i = (i + 1) & c->mask;
+    cache_entry* e = &c->slots[i];
+    e->key = key;
+    e->val = malloc(bytes);
+    STAT(tstats.allocs++);
+    memcpy(e->val, vals, bytes);
+    e->size = size;
+    memcpy(e->targets, targets, sizeof(e->targets));
+    e->used = c->stamp;
+    e->ref = 0;
+    c->bytes += bytes;
+    c->count++;
+    return e->val;
+}
+
+/*
+ * Subset engine:
+ * instead of trying every order of operations, compute the values reachable from every
+ * sub-multiset of a game once, bottom up. A subset with a single number reaches just that
+ * number, any larger subset reaches every result of combining a value of A with a value of B
+ * for all ways of splitting it into two disjoint, non-empty subsets A and B.
+ * Subsets are bitmasks over the (sorted) numbers of a game; subsets with the same numbers
+ * (e.g. either of two 5s) share their values, and splits with equal halves are only combined once.
+ * The values of the whole game are never stored, its combinations only mark targets.
+ * Subsets of at least CACHE_MIN_SIZE numbers are looked up in the thread's cache first.
+ */
+typedef struct dpctx {
+    int* buf; // values of all subsets
+    size_t used, cap;
+    size_t off[1 << MAX_SET]; // values of subset mask are buf[off[mask]..off[mask] + size[mask])
+    const int* ext[1 << MAX_SET]; // ... or ext[mask][0..size[mask]) if they came from the cache
+    int size[1 << MAX_SET];
+    int canon[1 << MAX_SET]; // lowest mask with the same numbers
+    // hash set deduplicating the values of the subset being computed, slots are valid if stamp == cur
+    int* keys;
+    unsigned int* stamp;
+    unsigned int cur, mask; // mask: amount of slots - 1
+    int count;
+    cache* cache; // NULL: no caching
+    int exhaustive; // compute every subset, even once all targets are reached (explain needs them)
+    int stop_target; // explain: stop at the first subset reaching it (0: don't)
+    int found; // ... that subset (the whole game if none of the stored ones did)
+    int ranges; // combine the halves of the whole game by range queries (see Meet in the middle)
+    int* tmp; // scratch for sorting
+    size_t tmp_cap;
+} dpctx;
+
+void dpctx_free(dpctx* dp) {
+    free(dp->buf);
+    free(dp->tmp);
+    free(dp->keys);
+    free(dp->stamp);
+    memset(dp, 0, sizeof(dpctx));
+}
+
+static void dp_rehash(dpctx* dp, int slots) {
+    int* keys = dp->keys;
+    unsigned int* stamp = dp->stamp;
+    unsigned int old = dp->mask + 1, cur = dp->cur;
+    dp->keys = malloc(sizeof(int) * slots);
+    dp->stamp = calloc(slots, sizeof(unsigned int));
+    STAT(tstats.allocs += 2);
+    dp->mask = slots - 1;
+    dp->cur = 1;
+    for (unsigned int i = 0; keys != NULL && i < old; i++)
+        if (stamp[i] == cur) {
+            unsigned int h = ((unsigned int)keys[i] * 2654435761u) & dp->mask;
+            while (dp->stamp[h] == 1) h = (h + 1) & dp->mask;
+            dp->stamp[h] = 1;
+            dp->keys[h] = keys[i];
+        }
+    free(keys);
+    free(stamp);
+}
+
+static inline void dp_clear(dpctx* dp) {
+    if (dp->keys == NULL) dp_rehash(dp, 1 << 12);
+    if (++dp->cur == 0) { // stamps wrapped around, really clear
+        memset(dp->stamp, 0, sizeof(unsigned int) * (dp->mask + 1));
+        dp->cur = 1;
+    }
+    dp->count = 0;
+}
+
+// adds val to the subset currently being computed, returns 1 if it wasn't part of it yet
+static inline int dp_add(dpctx* dp, int val) {
+    unsigned int h = ((unsigned int)val * 2654435761u) & dp->mask;
+    for (; dp->stamp[h] == dp->cur; h = (h + 1) & dp->mask)
+        if (dp->keys[h] == val) return 0;
+    dp->stamp[h] = dp->cur;
+    dp->keys[h] = val;
+    dp->buf[dp->used++] = val;
+    if (++dp->count * 2 > (int)dp->mask) dp_rehash(dp, (dp->mask + 1) * 2);
+    return 1;
+}
+
+static inline const int* dp_vals(const dpctx* dp, int mask) {
+    return dp->ext[mask] != NULL ? dp->ext[mask] : dp->buf + dp->off[mask];
+}
+
+static inline void dp_reserve(dpctx* dp, size_t size) {
+    if (dp->used + size <= dp->cap) return;
+    while (dp->used + size > dp->cap)
+        dp->cap = dp->cap ? dp->cap * 2 : 1 << 16;
+    dp->buf = realloc(dp->buf, sizeof(int) * dp->cap);
+    STAT(tstats.allocs++);
+}
+
+// combines the values of a and b, storing new values in the current subset unless it is the whole game
+static int dp_combine(dpctx* dp, solbits* sols, int a, int b, int store) {
+    if (store) dp_reserve(dp, 4 * (size_t)dp->size[a] * dp->size[b]);
+    const int* va = dp_vals(dp, a);
+    const int* vb = dp_vals(dp, b);
+    int size = __builtin_popcount(a | b);
+    for (int i = 0; i < dp->size[a]; i++)
+        for (int j = 0; j < dp->size[b]; j++) {
+            long long hi = va[i], lo = vb[j];
+            if (hi < lo) {
+                hi = vb[j];
+                lo = va[i];
             }
-        // 0 pairs
-        for (int i = 1; i < 7; i++)
-            for (int j = i + 1; j < 8; j++)
-                for (int k = j + 1; k < 9; k++)
-                    for (int l = k + 1; l < 10; l++)
-                        for (int m = l + 1; m < 11; m++) {
-                            linkedlist* set = asll6(larges[L], i, j, k, l, m);
-                            solution_set(solset, set);
-                            set_1_large_count++;
-                            sol_1_large_count += count_nz_then_clear(solset, 99, 1000);
-                        }
+            long long res[4];
+            int nres = 0;
+            res[nres++] = hi + lo;
+            if (hi > lo) res[nres++] = hi - lo;
+            res[nres++] = hi * lo;
+            if (hi % lo == 0) res[nres++] = hi / lo;
+            STAT(tstats.branches[OP_ADD]++);
+            STAT(tstats.branches[OP_SUB] += hi > lo);
+            STAT(tstats.branches[OP_MUL]++);
+            STAT(hi % lo == 0 ? tstats.branches[OP_DIV]++ : tstats.div_rejected++);
+            for (int k = 0; k < nres; k++) {
+                if (res[k] > 0x7fffffff) continue;
+                if (store && !dp_add(dp, res[k])) continue;
+                if (solbits_mark_at(sols, res[k], size) && !dp->exhaustive) return 1;
+            }
+        }
+    return 0;
+}
+
+/*
+ * Meet in the middle (--engine mitm):
+ * the subset engine, except for the largest subsets: their values are only needed to be combined
+ * into targets, but combining all of them is most of the work for games with several larges
+ * (the 5 numbers of 25, 50, 75, 100, 3, 6 without the 3 reach tens of thousands of values).
+ * The whole game only needs the values x op y of its splits that are targets, and a subset of all
+ * but one number c only those v with v op c (or c op v) a target, or v a target itself: a handful of ranges.
+ * So for these, the values of the larger half of every split are sorted, and for every value x
+ * of the smaller half only the y with x op y within one of the ranges [lo, hi] are visited, found by binary search:
+ * x + y: y in [lo - x, hi - x], x * y: y in [lo / x, hi / x], x - y and y - x: y in [x - hi, x - lo]
+ * and [x + lo, x + hi], x / y and y / x: y in [x / hi, x / lo] and [x * lo, x * hi] (if divisible).
+ * Subsets of all but one number only hold these values, so they aren't cached.
+ * Values are sorted in place (also in the cache, where the order doesn't matter).
+ */
+#define MAX_RANGES 8
+
+// sorts vals (positive) ascending, by radix sort unless there are only a few
+static void dp_sort(dpctx* dp, int* vals, int size) {
+    int i = 1;
+    while (i < size && vals[i - 1] <= vals[i]) i++;
+    if (i >= size) return;
+    if (size <= 64) { // insertion sort, from the first value out of order
+        for (; i < size; i++) {
+            int v = vals[i], k = i;
+            for (; k > 0 && vals[k - 1] > v; k--) vals[k] = vals[k - 1];
+            vals[k] = v;
+        }
+        return;
     }
-    printf("40%% (computed sets with 1 large)\n");
-
-    // 2 "larges"
-    for (int L1 = 0; L1 < 4; L1++)
-        for (int L2 = L1 + 1; L2 < 4; L2++) {
-            // 2 pairs
-            for (int i = 1; i < 10; i++)
-                for (int j = i + 1; j < 11; j++) {
-                    linkedlist* set = asll6(larges[L1], larges[L2], i, i, j, j);
-                    solution_set(solset, set);
-                    set_2_large_count++;
-                    sol_2_large_count += count_nz_then_clear(solset, 99, 1000);
-                }
-            // 1 pair
-            for (int i = 1; i < 11; i++)
-                for (int j = 1; j < 10; j++) {
-                    if (j == i) continue;
-                    for (int k = j + 1; k < 11; k++) {
-                        if (k == i) continue;
-                        linkedlist* set = asll6(larges[L1], larges[L2], i, i, j, k);
-                        solution_set(solset, set);
-                        set_2_large_count++;
-                        sol_2_large_count += count_nz_then_clear(solset, 99, 1000);
-                    }
-                }
-            // 0 pairs
-            for (int i = 1; i < 8; i++)
-                for (int j = i + 1; j < 9; j++)
-                    for (int k = j + 1; k < 10; k++)
-                        for (int l = k + 1; l < 11; l++) {
-                            linkedlist* set = asll6(larges[L1], larges[L2], i, j, k, l);
-                            solution_set(solset, set);
-                            set_2_large_count++;
-                            sol_2_large_count += count_nz_then_clear(solset, 99, 1000);
-                        }
+    if (dp->tmp_cap < (size_t)size) {
+        free(dp->tmp);
+        dp->tmp_cap = size * 2;
+        dp->tmp = malloc(sizeof(int) * dp->tmp_cap);
+        STAT(tstats.allocs++);
+    }
+    int *from = vals, *to = dp->tmp;
+    for (int shift = 0; shift < 32; shift += 11) {
+        unsigned int count[1 << 11] = { 0 };
+        for (i = 0; i < size; i++) count[(unsigned int)from[i] >> shift & 0x7ff]++;
+        if (count[(unsigned int)from[0] >> shift & 0x7ff] == (unsigned int)size) continue; // all the same digit
+        for (unsigned int k = 0, sum = 0; k < 1 << 11; k++) {
+            unsigned int c = count[k];
+            count[k] = sum;
+            sum += c;
         }
-    printf("60%% (computed sets with 2 larges)\n");
-
-    // 3 "larges"
-    for (int L1 = 0; L1 < 4; L1++)
-        for (int L2 = L1 + 1; L2 < 4; L2++)
-            for (int L3 = L2 + 1; L3 < 4; L3++) {
-                // 1 pair
-                for (int i = 1; i < 11; i++)
-                    for (int j = 1; j < 11; j++) {
-                        if (j == i) continue;
-                        linkedlist* set = asll6(larges[L1], larges[L2], larges[L3], i, i, j);
-                        solution_set(solset, set);
-                        set_3_large_count++;
-                        sol_3_large_count += count_nz_then_clear(solset, 99, 1000);
-                    }
-                // 0 pairs
-                for (int i = 1; i < 9; i++)
-                    for (int j = i + 1; j < 10; j++)
-                        for (int k = j + 1; k < 11; k++) {
-                            linkedlist* set = asll6(larges[L1], larges[L2], larges[L3], i, j, k);
-                            solution_set(solset, set);
-                            set_3_large_count++;
-                            sol_3_large_count += count_nz_then_clear(solset, 99, 1000);
-                        }
+        for (i = 0; i < size; i++) to[count[(unsigned int)from[i] >> shift & 0x7ff]++] = from[i];
+        int* t = from;
+        from = to;
+        to = t;
+    }
+    if (from != vals) memcpy(vals, from, sizeof(int) * size);
+}
+
+// first index of the sorted vals with vals[i] >= val
+static inline int lower_bound(const int* vals, int size, long long val) {
+    int lo = 0, hi = size;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (vals[mid] < val) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// the ranges (sorted, disjoint, lo and hi at even and odd indices) of values v of a subset with v, v op c or c op v
+// in the targets tlo..thi
+static int needed_ranges(long long c, long long tlo, long long thi, long long* r) {
+    long long raw[2 * 7] = {
+        tlo, thi,
+        tlo - c, thi - c,
+        tlo + c, thi + c,
+        c - thi, c - tlo,
+        (tlo + c - 1) / c, thi / c,
+        c * tlo, c * thi,
+        (c + thi - 1) / thi, c / tlo,
+    };
+    int n = 0;
+    for (int i = 0; i < 7; i++) { // insertion sort by lo, merging overlapping ranges
+        long long lo = raw[2 * i] < 1 ? 1 : raw[2 * i], hi = raw[2 * i + 1] > 0x7fffffff ? 0x7fffffff : raw[2 * i + 1];
+        if (lo > hi) continue;
+        int k = n;
+        while (k > 0 && r[2 * k - 2] > lo) {
+            r[2 * k] = r[2 * k - 2];
+            r[2 * k + 1] = r[2 * k - 1];
+            k--;
+        }
+        r[2 * k] = lo;
+        r[2 * k + 1] = hi;
+        n++;
+    }
+    int m = 0;
+    for (int i = 0; i < n; i++)
+        if (m > 0 && r[2 * i] <= r[2 * m - 1] + 1) {
+            if (r[2 * i + 1] > r[2 * m - 1]) r[2 * m - 1] = r[2 * i + 1];
+        } else {
+            r[2 * m] = r[2 * i];
+            r[2 * m + 1] = r[2 * i + 1];
+            m++;
+        }
+    return m;
+}
+
+// the results of combining the values of a and b within the ranges r, stored in the current subset if store,
+// returns 1 once all targets are reached
+static int dp_combine_ranges(dpctx* dp, solbits* sols, int a, int b, const long long* r, int nr, int store) {
+    if (dp->size[a] > dp->size[b]) {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    int size = __builtin_popcount(a | b), nb = dp->size[b];
+    if (store) dp_reserve(dp, 4 * (size_t)dp->size[a] * nb); // may move buf, before taking pointers into it
+    int* vb = (int*)dp_vals(dp, b); // sorting doesn't change the values
+    const int* va = dp_vals(dp, a);
+    dp_sort(dp, vb, nb);
+#define DP_EMIT(val) do { \
+        long long v_ = (val); \
+        if (store && !dp_add(dp, v_)) break; \
+        if (solbits_mark_at(sols, v_, size) && !dp->exhaustive) return 1; \
+    } while (0)
+    for (int i = 0; i < dp->size[a]; i++) {
+        long long x = va[i];
+        for (int k = 0; k < nr; k++) {
+            long long lo = r[2 * k], hi = r[2 * k + 1];
+            int j, e;
+            for (j = lower_bound(vb, nb, lo - x); j < nb && vb[j] <= hi - x; j++) DP_EMIT(x + vb[j]);
+            for (j = lower_bound(vb, nb, (lo + x - 1) / x); j < nb && vb[j] <= hi / x; j++) DP_EMIT(x * vb[j]);
+            for (j = lower_bound(vb, nb, x - hi), e = lower_bound(vb, nb, x - lo + 1); j < e; j++) DP_EMIT(x - vb[j]);
+            for (j = lower_bound(vb, nb, x + lo); j < nb && vb[j] <= x + hi; j++) DP_EMIT(vb[j] - x);
+            for (j = lower_bound(vb, nb, (x + hi - 1) / hi), e = lower_bound(vb, nb, x / lo + 1); j < e; j++)
+                if (x % vb[j] == 0) DP_EMIT(x / vb[j]);
+            for (j = lower_bound(vb, nb, x * lo); j < nb && vb[j] <= x * hi; j++)
+                if (vb[j] % x == 0) DP_EMIT(vb[j] / x);
+        }
+    }
+#undef DP_EMIT
+    return 0;
+}
+
+// explain: 1 if the subset mask reaches stop_target, it becomes dp->found
+static inline int dp_reaches(dpctx* dp, int mask) {
+    if (dp->stop_target == 0) return 0;
+    const int* vals = dp_vals(dp, mask);
+    for (int i = 0; i < dp->size[mask]; i++)
+        if (vals[i] == dp->stop_target) {
+            dp->found = mask;
+            return 1;
+        }
+    return 0;
+}
+
+// marks all targets reachable from set, returns 1 if the computation was stopped early since all of them were reached
+// (or, with stop_target, a subset reaching it was found)
+int solution_set_dp(dpctx* dp, solbits* sols, const gamestate* set) {
+    int n = set->size, full = (1 << n) - 1;
+    dp->used = 0;
+    dp->found = full;
+    if (dp->cache != NULL) dp->cache->stamp++;
+
+    // canonical masks: within runs of equal numbers, always select the first ones
+    for (int mask = 1; mask <= full; mask++) {
+        int canon = 0;
+        for (int i = 0; i < n; ) {
+            int e = i, k = 0;
+            for (; e < n && set->val[e] == set->val[i]; e++)
+                if (mask & (1 << e)) k++;
+            for (; k > 0; k--, i++) canon |= 1 << i;
+            i = e;
+        }
+        dp->canon[mask] = canon;
+    }
+
+    for (int mask = 1; mask <= full; mask++) {
+        if (dp->canon[mask] != mask) { // same numbers as an already computed subset
+            dp->off[mask] = dp->off[dp->canon[mask]];
+            dp->ext[mask] = dp->ext[dp->canon[mask]];
+            dp->size[mask] = dp->size[dp->canon[mask]];
+            continue;
+        }
+        int store = mask != full;
+        dp->off[mask] = dp->used;
+        dp->ext[mask] = NULL;
+        long long tlo = dp->stop_target ? dp->stop_target : MIN_TARGET, thi = dp->stop_target ? dp->stop_target : MAX_TARGET;
+        long long ranges[2 * MAX_RANGES] = { tlo, thi };
+        int nranges = 0; // 0: all values
+        if (dp->ranges && !store) nranges = 1;
+        else if (dp->ranges && n > 2 && __builtin_popcount(mask) == n - 1) // only combined with the remaining number
+            nranges = needed_ranges(set->val[__builtin_ctz(full ^ mask)], tlo, thi, ranges);
+
+        unsigned long long key = 0;
+        if (dp->cache != NULL && store && nranges == 0 && __builtin_popcount(mask) >= CACHE_MIN_SIZE && set->val[0] < 1 << 7) {
+            int vals[MAX_SET], k = 0;
+            for (int i = 0; i < n; i++)
+                if (mask & (1 << i)) vals[k++] = set->val[i];
+            key = cache_key(vals, k);
+            cache_entry* e = cache_get(dp->cache, key);
+            if (e != NULL) {
+                dp->ext[mask] = e->val;
+                dp->size[mask] = e->size;
+                if (solbits_or(sols, e->targets) && !dp->exhaustive) return 1;
+                if (dp_reaches(dp, mask)) return 1;
+                continue;
             }
-    printf("80%% (computed sets with 3 larges)\n");
-
-    // 4 "larges"
-    for (int L1 = 0; L1 < 4; L1++)
-        for (int L2 = L1 + 1; L2 < 4; L2++)
-            for (int L3 = L2 + 1; L3 < 4; L3++)
-                for (int L4 = L3 + 1; L4 < 4; L4++) {
-                    // 1 pair
-                    for (int i = 1; i < 11; i++) {
-                        linkedlist* set = asll6(larges[L1], larges[L2], larges[L3], larges[L4], i, i);
-                        solution_set(solset, set);
-                        set_4_large_count++;
-                        sol_4_large_count += count_nz_then_clear(solset, 99, 1000);
-                    }
-                    // 0 pairs
-                    for (int i = 1; i < 10; i++)
-                        for (int j = i + 1; j < 11; j++) {
-                            linkedlist* set = asll6(larges[L1], larges[L2], larges[L3], larges[L4], i, j);
-                            solution_set(solset, set);
-                            set_4_large_count++;
-                            sol_4_large_count += count_nz_then_clear(solset, 99, 1000);
-                        }
+        }
+
+        if ((mask & (mask - 1)) == 0) { // single number
+            dp_reserve(dp, 1);
+            dp_clear(dp);
+            dp_add(dp, set->val[__builtin_ctz(mask)]);
+            dp->size[mask] = 1;
+            if (dp_reaches(dp, mask)) return 1;
+            continue;
+        }
+        dp_clear(dp);
+        unsigned long long seen = 0;
+        int low = mask & -mask;
+        for (int a = (mask - 1) & mask; a > 0; a = (a - 1) & mask) {
+            int b = mask ^ a;
+            if (!(a & low)) continue; // every split once, a holds the first number
+            int ca = dp->canon[a], cb = dp->canon[b];
+            if (seen & ((1ULL << ca) | (1ULL << cb))) continue; // same halves as an earlier split
+            seen |= 1ULL << ca;
+            COUNT_NODES(1);
+            STAT(tstats.nodes[__builtin_popcount(mask)]++);
+            if (nranges > 0 ? dp_combine_ranges(dp, sols, a, b, ranges, nranges, store) : dp_combine(dp, sols, a, b, store))
+                if (!dp->exhaustive) return 1;
+        }
+        dp->size[mask] = dp->used - dp->off[mask];
+
+        if (key != 0) {
+            unsigned long long targets[SOLBITS_WORDS] = { 0 };
+            const int* vals = dp_vals(dp, mask);
+            for (int i = 0; i < dp->size[mask]; i++) {
+                unsigned int idx = vals[i] - MIN_TARGET;
+                if (idx < NUM_TARGETS) targets[idx >> 6] |= 1ULL << (idx & 63);
+            }
+            cache_put(dp->cache, key, vals, dp->size[mask], targets);
+        }
+        if (store && dp_reaches(dp, mask)) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Solver:
+ * everything a thread needs to compute the targets of sets with the selected engine.
+ */
+typedef enum engine {
+    ENGINE_SEARCH, // solution_set, trying all orders of operations
+    ENGINE_SUBSET, // solution_set_dp
+    ENGINE_MITM, // solution_set_dp, with range queries for the whole game
+    NUM_ENGINES
+} engine;
+
+const char* engine_names[] = { "search", "subset", "mitm" };
+engine selected_engine = ENGINE_SUBSET;
+int count_expressions = 0; // counting mode (search engine only), see solbits
+
+typedef struct solver {
+    solbits sols;
+    dpctx dp;
+    cache cache;
+    unsigned long long* game_bits; // if not NULL, the targets of every solved set are copied here, one after another
+    gamestate explained; // the set whose subsets are in dp after explain (size 0: none)
+    unsigned long long games; // solved so far (read by the progress reporter)
+} solver;
+
+solver* solver_new() {
+    solver* sv = calloc(1, sizeof(solver));
+    if (count_expressions) sv->sols.exprs = calloc(NUM_TARGETS, sizeof(unsigned long long));
+    if (cache_max_bytes > 0) {
+        cache_init(&sv->cache, cache_max_bytes);
+        sv->dp.cache = &sv->cache;
+    }
+    return sv;
+}
+
+void solver_free(solver* sv) {
+    dpctx_free(&sv->dp);
+    cache_free(&sv->cache);
+    free(sv->sols.exprs);
+    free(sv);
+}
+
+static inline void solve(solver* sv, const gamestate* set) {
+    sv->explained.size = 0;
+    __atomic_store_n(&sv->games, sv->games + 1, __ATOMIC_RELAXED);
+    switch (selected_engine) {
+    case ENGINE_SEARCH: solution_set(&sv->sols, set); break;
+    case ENGINE_SUBSET: solution_set_dp(&sv->dp, &sv->sols, set); break;
+    case ENGINE_MITM:
+        sv->dp.ranges = 1;
+        solution_set_dp(&sv->dp, &sv->sols, set);
+        sv->dp.ranges = 0;
+        break;
+    default: break;
+    }
+    if (sv->game_bits != NULL) {
+        memcpy(sv->game_bits, sv->sols.bits, sizeof(sv->sols.bits));
+        sv->game_bits += SOLBITS_WORDS;
+    }
+}
+
+/*
+ * Explanations (--explain):
+ * how a target is reached, e.g. 952 = ((100 + 6) * 3 * 75 - 50) / 25 (fully parenthesized).
+ * The subset engine computes the values of the sub-multisets of the set (in order of their masks, so
+ * every subset comes after its own subsets) until the first one containing the target. The values
+ * serve as back-pointers: a value of a subset is the result of a value of A and a value of B for one of
+ * its splits, so finding that pair and repeating this for both of them rebuilds the expression top down.
+ * The values stay until the solver solves another set, so a target of the same set reached by one of
+ * the subsets computed so far only takes the rebuild (microseconds), others compute them again.
+ * Besides the engine's own (reused) buffers and cache, nothing is allocated, the expression is
+ * written to the caller's buffer, like snprintf.
+ */
+typedef struct writer {
+    char* buf;
+    size_t len, pos; // pos may exceed len, then the output was cut off
+} writer;
+
+static void write_str(writer* w, const char* str) {
+    for (; *str; str++, w->pos++)
+        if (w->pos + 1 < w->len) w->buf[w->pos] = *str;
+    if (w->len > 0) w->buf[w->pos < w->len ? w->pos : w->len - 1] = '\0';
+}
+
+static void write_int(writer* w, int val) {
+    char num[16];
+    snprintf(num, sizeof(num), "%d", val);
+    write_str(w, num);
+}
+
+// writes how value is computed from exactly the numbers of mask (which must reach it), returns 0 if it doesn't
+static int explain_mask(const dpctx* dp, const gamestate* set, int mask, int value, writer* w, int top) {
+    if ((mask & (mask - 1)) == 0) {
+        if (set->val[__builtin_ctz(mask)] != value) return 0;
+        write_int(w, value);
+        return 1;
+    }
+    int low = mask & -mask;
+    for (int a = (mask - 1) & mask; a > 0; a = (a - 1) & mask) {
+        int b = mask ^ a;
+        if (!(a & low)) continue;
+        const int* va = dp_vals(dp, a);
+        const int* vb = dp_vals(dp, b);
+        for (int i = 0; i < dp->size[a]; i++)
+            for (int j = 0; j < dp->size[b]; j++) {
+                long long hi = va[i], lo = vb[j];
+                int hmask = a, lmask = b;
+                if (hi < lo) {
+                    hi = vb[j];
+                    lo = va[i];
+                    hmask = b;
+                    lmask = a;
                 }
-    printf("100%% (computed sets with 4 larges)\n");
+                const char* op;
+                if (hi + lo == value) op = " + ";
+                else if (hi - lo == value && hi > lo) op = " - ";
+                else if (hi * lo == value) op = " * ";
+                else if (hi % lo == 0 && hi / lo == value) op = " / ";
+                else continue;
+                if (!top) write_str(w, "(");
+                if (!explain_mask(dp, set, hmask, hi, w, 0)) return 0;
+                write_str(w, op);
+                if (!explain_mask(dp, set, lmask, lo, w, 0)) return 0;
+                if (!top) write_str(w, ")");
+                return 1;
+            }
+    }
+    return 0;
+}
 
-    // printf("found %d solutions for %d sets with 0 large numbers (%.3f%%)\n", sol_0_large_count, set_0_large_count, 100.0*sol_0_large_count/set_0_large_count);
-    printf("found %llu solutions for %llu sets with 1 large number  (%.3f%%)\n", sol_1_large_count, set_1_large_count, 100.0*sol_1_large_count/set_1_large_count);
-    printf("found %llu solutions for %llu sets with 2 large numbers (%.3f%%)\n", sol_2_large_count, set_2_large_count, 100.0*sol_2_large_count/set_2_large_count);
-    printf("found %llu solutions for %llu sets with 3 large numbers (%.3f%%)\n", sol_3_large_count, set_3_large_count, 100.0*sol_3_large_count/set_3_large_count);
-    printf("found %llu solutions for %llu sets with 4 large numbers (%.3f%%)\n", sol_4_large_count, set_4_large_count, 100.0*sol_4_large_count/set_4_large_count);
-    printf("found %llu total solutions for %llu total sets (%.3f%%)\n", solset[0], set_1_large_count + set_2_large_count + set_3_large_count + set_4_large_count, 100.0*solset[0]/(set_1_large_count + set_2_large_count + set_3_large_count + set_4_large_count));
-    free(solset);
+// writes how target is reached from set to buf (at most len bytes, like snprintf),
+// returns the length of the expression (even if it was cut off), -1 if the target can't be reached
+int explain(solver* sv, const gamestate* set, int target, char* buf, size_t len) {
+    writer w = { buf, len, 0 };
+    int full = (1 << set->size) - 1, best = 0;
+    if (len > 0) buf[0] = '\0';
+    if (target < 1 || set->size < 1) return -1;
+    if (sv->explained.size == set->size && memcmp(sv->explained.val, set->val, sizeof(int) * set->size) == 0) {
+        // the subsets up to the one found last time are still there (all their values, if they have n - 2 numbers at most)
+        for (int mask = 1; mask <= sv->dp.found && mask < full && best == 0; mask++) {
+            if (sv->dp.canon[mask] != mask || (set->size > 2 && __builtin_popcount(mask) >= set->size - 1)) continue;
+            const int* vals = dp_vals(&sv->dp, mask);
+            for (int i = 0; i < sv->dp.size[mask]; i++)
+                if (vals[i] == target) best = mask;
+        }
+    }
+    if (best == 0) {
+        sv->dp.exhaustive = 1;
+        sv->dp.ranges = 1; // the largest subsets only keep what can still become the target
+        sv->dp.stop_target = target;
+        solution_set_dp(&sv->dp, &sv->sols, set);
+        sv->dp.exhaustive = 0;
+        sv->dp.ranges = 0;
+        sv->dp.stop_target = 0;
+        solbits_count_then_clear(&sv->sols);
+        sv->explained = *set;
+        best = sv->dp.found; // the whole game: never stored, but its splits are
+    }
+    if (!explain_mask(&sv->dp, set, best, target, &w, 1)) return -1;
+    return w.pos;
 }
 
-int main(int argc, char *argv[]) {
-    clock_t start = clock();
-    iterate_sets();
-    printf("took %.3fs to compute\n", (clock() - start) * 1.0 / CLOCKS_PER_SEC);
+/*
+ * Large number options:
+ * an option is a set of four distinct 'large' numbers in the range MIN_LARGE..MAX_LARGE,
+ * options are numbered in lexicographic order, starting at 0 ({ 11, 12, 13, 14 }) up to
+ * NUM_OPTIONS - 1 ({ 97, 98, 99, 100 }). The index is stable, so ranges of it can be
+ * handed out to different processes/machines and the results concatenated afterwards.
+ */
+#define MIN_LARGE 11
+#define MAX_LARGE 100
+#define LARGE_RANGE (MAX_LARGE - MIN_LARGE + 1)
+#define NUM_OPTIONS 2555190 // binom(90, 4)
+
+typedef struct option_result {
+    unsigned long long sets[5]; // indexed by the amount of larges in a set
+    unsigned long long sols[5];
+    unsigned long long exprs[5]; // --count-expressions: expressions reaching a target
+} option_result;
+
+size_t binom(int n, int k) {
+    if (k < 0 || n < k) return 0;
+    size_t res = 1;
+    for (int i = 1; i <= k; i++)
+        res = res * (n - k + i) / i;
+    return res;
+}
+
+// subsets of n larges are numbered lexicographically as well, options are the subsets with n = 4
+void subset_larges(size_t idx, int n, int* larges) {
+    int v = 0;
+    for (int k = n; k > 0; k--, v++) {
+        for (size_t c; idx >= (c = binom(LARGE_RANGE - v - 1, k - 1)); v++)
+            idx -= c;
+        larges[n - k] = MIN_LARGE + v;
+    }
+}
+
+size_t subset_index(const int* larges, int n) { // larges must be sorted ascending
+    size_t idx = 0;
+    for (int k = n, v = 0; k > 0; k--, v++)
+        for (; v < larges[n - k] - MIN_LARGE; v++)
+            idx += binom(LARGE_RANGE - v - 1, k - 1);
+    return idx;
+}
+
+void option_larges(size_t idx, int* larges) {
+    subset_larges(idx, 4, larges);
+}
+
+size_t option_index(const int* larges) { // larges must be sorted ascending
+    return subset_index(larges, 4);
+}
+
+/*
+ * Game table:
+ * the small numbers of a game are a multiset of 6 - n numbers of 1..SMALL_MAX (n: amount of larges),
+ * each at most twice. They don't depend on the larges, so they are listed once per n by games_init,
+ * every row already sorted descending: since larges are > SMALL_MAX, a game is the sorted larges
+ * followed by a row, without sorting anything per game.
+ * Rows are ordered by the amount of pairs (most first), then lexicographically by the paired and
+ * then the single numbers, the order games are stored in (see --store-games) and queried by.
+ */
+typedef struct smalls {
+    unsigned char val[6]; // descending, 6 - n of them
+} smalls;
+
+const unsigned long long subset_games[5] = { 2850, 1452, 615, 210, 55 }; // games per subset of n larges
+smalls* small_games[5]; // [n], subset_games[n] rows each
+
+// the next combination of r increasing indices below max, 0 after the last
+static int next_combination(int* c, int r, int max) {
+    int i = r - 1;
+    while (i >= 0 && c[i] == max - r + i) i--;
+    if (i < 0) return 0;
+    c[i]++;
+    for (int j = i + 1; j < r; j++) c[j] = c[j - 1] + 1;
+    return 1;
+}
+
+void games_init() {
+    for (int n = 0; n < 5; n++) {
+        int k = 6 - n;
+        smalls* row = small_games[n] = malloc(sizeof(smalls) * subset_games[n]);
+        for (int p = k / 2; p >= 0; p--) {
+            int pc[3], sc[6];
+            for (int i = 0; i < p; i++) pc[i] = i;
+            do {
+                int rest[SMALL_MAX], nrest = 0; // the values not paired
+                for (int v = 1, i = 0; v <= SMALL_MAX; v++) {
+                    if (i < p && pc[i] == v - 1) i++;
+                    else rest[nrest++] = v;
+                }
+                for (int i = 0; i < k - 2 * p; i++) sc[i] = i;
+                do {
+                    int v[6], nv = 0;
+                    for (int i = 0; i < p; i++) v[nv++] = pc[i] + 1, v[nv++] = pc[i] + 1;
+                    for (int i = 0; i < k - 2 * p; i++) v[nv++] = rest[sc[i]];
+                    for (int i = 1; i < nv; i++) // insertion sort, descending
+                        for (int j = i; j > 0 && v[j - 1] < v[j]; j--) {
+                            int t = v[j]; v[j] = v[j - 1]; v[j - 1] = t;
+                        }
+                    for (int i = 0; i < nv; i++) row->val[i] = v[i];
+                    row++;
+                } while (next_combination(sc, k - 2 * p, nrest));
+            } while (next_combination(pc, p, SMALL_MAX));
+        }
+        if (row != small_games[n] + subset_games[n]) {
+            fprintf(stderr, "listed %td games with %d larges, expected %llu\n", row - small_games[n], n, subset_games[n]);
+            exit(1);
+        }
+    }
+}
+
+// computes all sets made up of the n given larges and 6 - n small numbers (n = 0..4)
+void iterate_games(const int* larges, int n, solver* sv, option_result* res) {
+    gamestate set = { .size = MAX_SET };
+    STAT(tstats_larges = n);
+    for (int i = 0; i < n; i++) { // descending, wherever the larges came from
+        int j = i;
+        for (; j > 0 && set.val[j - 1] < larges[i]; j--) set.val[j] = set.val[j - 1];
+        set.val[j] = larges[i];
+    }
+    for (const smalls* row = small_games[n]; row < small_games[n] + subset_games[n]; row++) {
+        for (int i = n; i < MAX_SET; i++) set.val[i] = row->val[i - n];
+        solve(sv, &set);
+        res->sets[n]++;
+        res->exprs[n] += solbits_exprs_then_clear(&sv->sols);
+        res->sols[n] += solbits_count_then_clear(&sv->sols);
+    }
+}
+
+/*
+ * Results store (--store file, --store-games):
+ * a binary file the results are written to in columns, so they can be memory-mapped and read
+ * without parsing 2.5M text lines. It starts with a store_header holding the offsets of its columns
+ * (64 byte aligned, native byte order):
+ * - index: the option index of every record (unsigned int)
+ * - sols[n], n = 1..4: the solvable games with n larges of every record (unsigned int)
+ * - games[n] (only with --store-games): the targets reachable in every game, SOLBITS_WORDS 64 bit words
+ *   each, in the order iterate_games computes them. Games with 1 to 3 larges are the same for every
+ *   option containing these larges, so they are stored only once per subset of larges (all of them,
+ *   by subset_index), only the games with all 4 larges are stored per record. For all options, this is
+ *   about 20 GB instead of 3 TB, and any game can still be found without an index.
+ * Games are written by the workers directly into the mapped file, the rest by the main thread.
+ * An existing file with the same header is reused, so the games of options resumed from a checkpoint are kept.
+ */
+#define STORE_MAGIC "CDSTORE"
+#define STORE_VERSION 1
+#define STORE_GAMES 1 // flag: the file contains the targets of every game
+
+typedef struct store_header {
+    char magic[8];
+    unsigned int version, flags;
+    unsigned long long start, end; // options [start, end), one record each
+    unsigned int min_target, max_target, words, reserved; // words: 64 bit words per game
+    unsigned long long sets[5]; // games per subset of n larges
+    unsigned long long index, sols[5], games[5]; // column offsets, 0 if not present
+    unsigned long long size; // of the whole file
+} store_header;
+
+typedef struct store {
+    int fd;
+    unsigned char* map;
+    store_header* hdr;
+    unsigned int* index;
+    unsigned int* sols[5];
+    unsigned long long* games[5];
+} store;
+
+const char* store_path = NULL;
+int store_games = 0;
+store* results_store = NULL;
+
+static unsigned long long store_column(unsigned long long* off, unsigned long long bytes) {
+    unsigned long long at = *off;
+    *off = (at + bytes + 63) & ~63ULL;
+    return at;
+}
+
+static void store_map(store* st, const char* path, size_t size, int prot) {
+    st->map = mmap(NULL, size, prot, MAP_SHARED, st->fd, 0);
+    if (st->map == MAP_FAILED) {
+        perror(path);
+        exit(1);
+    }
+    st->hdr = (store_header*)st->map;
+    st->index = (unsigned int*)(st->map + st->hdr->index);
+    for (int n = 1; n < 5; n++) {
+        st->sols[n] = (unsigned int*)(st->map + st->hdr->sols[n]);
+        st->games[n] = st->hdr->games[n] ? (unsigned long long*)(st->map + st->hdr->games[n]) : NULL;
+    }
+}
+
+store* store_create(const char* path, size_t start, size_t end, int flags) {
+    store_header hdr = { STORE_MAGIC, STORE_VERSION, flags, start, end, MIN_TARGET, MAX_TARGET, SOLBITS_WORDS };
+    unsigned long long off = sizeof(store_header), records = end - start;
+    memcpy(hdr.sets, subset_games, sizeof(hdr.sets));
+    hdr.sets[0] = 0; // the games without larges are the same for every option, they aren't stored
+    hdr.index = store_column(&off, records * sizeof(unsigned int));
+    for (int n = 1; n < 5; n++)
+        hdr.sols[n] = store_column(&off, records * sizeof(unsigned int));
+    if (flags & STORE_GAMES)
+        for (int n = 1; n < 5; n++)
+            hdr.games[n] = store_column(&off, (n < 4 ? binom(LARGE_RANGE, n) : records) * subset_games[n] * SOLBITS_WORDS * 8);
+    hdr.size = off;
+
+    store* st = calloc(1, sizeof(store));
+    store_header old;
+    if ((st->fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+        perror(path);
+        exit(1);
+    }
+    if (pread(st->fd, &old, sizeof(old), 0) != sizeof(old) || memcmp(&old, &hdr, sizeof(hdr)) != 0) { // start over
+        if (ftruncate(st->fd, 0) != 0 || ftruncate(st->fd, hdr.size) != 0 || pwrite(st->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+            perror(path);
+            exit(1);
+        }
+    }
+    store_map(st, path, hdr.size, PROT_READ | PROT_WRITE);
+    return st;
+}
+
+// opens an existing store read-only
+store* store_open(const char* path) {
+    store* st = calloc(1, sizeof(store));
+    store_header hdr;
+    if ((st->fd = open(path, O_RDONLY)) < 0) {
+        perror(path);
+        exit(1);
+    }
+    if (pread(st->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || memcmp(hdr.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0
+            || hdr.version != STORE_VERSION || hdr.words != SOLBITS_WORDS) {
+        fprintf(stderr, "%s is not a results store (of this version)\n", path);
+        exit(1);
+    }
+    store_map(st, path, hdr.size, PROT_READ);
+    return st;
+}
+
+// where the games of the subset of n larges go, NULL if games aren't stored
+unsigned long long* store_game_bits(store* st, const int* larges, int n) {
+    if (st == NULL || st->games[n] == NULL) return NULL;
+    size_t rec = n < 4 ? subset_index(larges, n) : option_index(larges) - st->hdr->start;
+    return st->games[n] + rec * subset_games[n] * SOLBITS_WORDS;
+}
+
+void store_option(store* st, size_t idx, const option_result* res) {
+    size_t rec = idx - st->hdr->start;
+    st->index[rec] = idx;
+    for (int n = 1; n < 5; n++)
+        st->sols[n][rec] = res->sols[n];
+}
+
+void store_close(store* st) {
+    size_t size = st->hdr->size;
+    msync(st->map, size, MS_SYNC);
+    munmap(st->map, size);
+    close(st->fd);
+    free(st);
+}
+
+// computes the sets of an option containing exactly the larges selected by mask (bit L selects larges[L])
+void iterate_subset(const int* larges, int mask, solver* sv, option_result* res) {
+    int chosen[4], n = 0;
+    for (int L = 0; L < 4; L++)
+        if (mask & (1 << L)) chosen[n++] = larges[L];
+    sv->game_bits = store_game_bits(results_store, chosen, n);
+    iterate_games(chosen, n, sv, res);
+    sv->game_bits = NULL;
+}
+
+/*
+ * Distinct sets (--dedup):
+ * sets with n < 4 larges only depend on those n larges, so all options sharing them share
+ * these sets, too (the sets with just the 11 are the same for { 11, 12, 13, 14 } and { 11, 20, 30, 40 }).
+ * In this mode, the sets of every subset of 1, 2 or 3 larges needed by the computed options
+ * are computed exactly once into the tier tables first (90 + 4005 + 117480 subsets at most).
+ * Options then only compute their sets with all 4 larges and add up the tables for the rest.
+ */
+typedef struct tier {
+    unsigned int* sols; // solvable games per subset of larges
+    unsigned char* needed;
+    unsigned long long sets; // sets per subset of larges
+} tier;
+
+int dedup = 0;
+tier tiers[4]; // indexed by the amount of larges, 1..3
+
+void tiers_init() {
+    for (int n = 1; n < 4; n++) {
+        tiers[n].sols = calloc(binom(LARGE_RANGE, n), sizeof(unsigned int));
+        tiers[n].needed = calloc(binom(LARGE_RANGE, n), 1);
+    }
+}
+
+void tiers_free() {
+    for (int n = 1; n < 4; n++) {
+        free(tiers[n].sols);
+        free(tiers[n].needed);
+    }
+    memset(tiers, 0, sizeof(tiers));
+}
+
+// jobs are (subset index, amount of larges) pairs, packed into one number
+// options with pending < 0 are already complete (loaded from a checkpoint) and need none
+size_t tiers_jobs(size_t start, size_t end, const int* pending, size_t** jobs) {
+    for (size_t idx = start; idx < end; idx++) {
+        if (pending[idx - start] < 0) continue;
+        int larges[4];
+        option_larges(idx, larges);
+        for (int mask = 1; mask < 15; mask++) {
+            int chosen[4], n = 0;
+            for (int L = 0; L < 4; L++)
+                if (mask & (1 << L)) chosen[n++] = larges[L];
+            tiers[n].needed[subset_index(chosen, n)] = 1;
+        }
+    }
+    size_t njobs = 0;
+    *jobs = NULL;
+    for (int n = 3; n > 0; n--) // most expensive first
+        for (size_t i = 0; i < binom(LARGE_RANGE, n); i++)
+            if (tiers[n].needed[i]) {
+                if ((njobs & (njobs - 1)) == 0) *jobs = realloc(*jobs, sizeof(size_t) * (njobs ? njobs * 2 : 1));
+                (*jobs)[njobs++] = i << 2 | n;
+            }
+    return njobs;
+}
+
+void tiers_run_job(size_t job, solver* sv) {
+    int n = job & 3, larges[3];
+    size_t idx = job >> 2;
+    option_result res = { 0 };
+    subset_larges(idx, n, larges);
+    sv->game_bits = store_game_bits(results_store, larges, n);
+    iterate_games(larges, n, sv, &res);
+    sv->game_bits = NULL;
+    tiers[n].sols[idx] = res.sols[n];
+    __atomic_store_n(&tiers[n].sets, res.sets[n], __ATOMIC_RELAXED);
+}
+
+// adds the sets of the option with less than 4 larges from the tier tables
+void tiers_lookup(const int* larges, option_result* res) {
+    for (int mask = 1; mask < 15; mask++) {
+        int chosen[4], n = 0;
+        for (int L = 0; L < 4; L++)
+            if (mask & (1 << L)) chosen[n++] = larges[L];
+        res->sets[n] += tiers[n].sets;
+        res->sols[n] += tiers[n].sols[subset_index(chosen, n)];
+    }
+}
+
+int format_option(char* buf, size_t len, size_t idx, const int* larges, const option_result* res) {
+    unsigned long long sets = 0, sols = 0;
+    for (int n = 1; n < 5; n++) {
+        sets += res->sets[n];
+        sols += res->sols[n];
+    }
+    return snprintf(buf, len, "%zu %d %d %d %d %llu %llu %llu %llu %llu %llu %llu %llu %.3f\n", idx, larges[0], larges[1], larges[2], larges[3],
+            res->sols[1], res->sols[2], res->sols[3], res->sols[4],
+            res->sets[1], res->sets[2], res->sets[3], res->sets[4], 100.0*sols/(sets*NUM_TARGETS));
+}
+
+void print_option(FILE* out, size_t idx, const int* larges, const option_result* res) {
+    char line[256];
+    format_option(line, sizeof(line), idx, larges, res);
+    fputs(line, out);
+    fflush(out);
+}
+
+double wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// cpu time of this process and its (exited) worker processes
+double cpu_time() {
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    return self.ru_utime.tv_sec + self.ru_stime.tv_sec + children.ru_utime.tv_sec + children.ru_stime.tv_sec
+            + (self.ru_utime.tv_usec + self.ru_stime.tv_usec + children.ru_utime.tv_usec + children.ru_stime.tv_usec) * 1e-6;
+}
+
+/*
+ * Checkpoints (--checkpoint file):
+ * the result line of every computed option is appended to the file as well, which is fsync'd
+ * every CHECKPOINT_SYNC_SECONDS and at the end. A run with the same file skips the options
+ * already in it and prints their lines from there, so the output of a run that was interrupted
+ * (any number of times) is the same as that of a run that wasn't.
+ * Lines cut off by a crash are dropped, together with everything after them.
+ */
+#define CHECKPOINT_SYNC_SECONDS 10
+
+const char* checkpoint_path = NULL;
+FILE* checkpoint = NULL;
+time_t checkpoint_synced;
+
+// opens the checkpoint file and loads the options of [start, end) in it, marking them with pending = -1
+size_t checkpoint_open(size_t start, size_t end, option_result* results, int* pending) {
+    checkpoint = fopen(checkpoint_path, "a+");
+    if (checkpoint == NULL) {
+        perror(checkpoint_path);
+        exit(1);
+    }
+    char line[256];
+    long valid = 0;
+    size_t loaded = 0;
+    rewind(checkpoint);
+    while (fgets(line, sizeof(line), checkpoint) != NULL && strchr(line, '\n') != NULL) {
+        size_t idx;
+        int larges[4], expected[4];
+        option_result res = { 0 };
+        if (sscanf(line, "%zu %d %d %d %d %llu %llu %llu %llu %llu %llu %llu %llu", &idx, &larges[0], &larges[1], &larges[2], &larges[3],
+                &res.sols[1], &res.sols[2], &res.sols[3], &res.sols[4], &res.sets[1], &res.sets[2], &res.sets[3], &res.sets[4]) != 13
+                || idx >= NUM_OPTIONS)
+            break;
+        option_larges(idx, expected);
+        if (memcmp(larges, expected, sizeof(larges)) != 0) break;
+        valid = ftell(checkpoint);
+        if (idx >= start && idx < end && pending[idx - start] >= 0) {
+            results[idx - start] = res;
+            pending[idx - start] = -1;
+            loaded++;
+        }
+    }
+    if (ftruncate(fileno(checkpoint), valid) != 0) {
+        perror(checkpoint_path);
+        exit(1);
+    }
+    fseek(checkpoint, 0, SEEK_END);
+    checkpoint_synced = time(NULL);
+    return loaded;
+}
+
+void checkpoint_sync() {
+    fflush(checkpoint);
+    if (fsync(fileno(checkpoint)) != 0) perror(checkpoint_path);
+    checkpoint_synced = time(NULL);
+}
+
+void checkpoint_write(size_t idx, const int* larges, const option_result* res) {
+    print_option(checkpoint, idx, larges, res);
+    if (time(NULL) - checkpoint_synced >= CHECKPOINT_SYNC_SECONDS) checkpoint_sync();
+}
+
+void checkpoint_close() {
+    checkpoint_sync();
+    fclose(checkpoint);
+    checkpoint = NULL;
+}
+
+/*
+ * Placement (--affinity compact|scatter):
+ * pins worker i (threads of all processes, numbered across them) to the i-th cpu of an order
+ * given by the policy, over the cpus this process may run on (wrapping around if there are more workers).
+ * compact fills one numa node after the other, scatter takes turns between the nodes; within a node,
+ * every core gets a worker before the second hardware threads of the cores do.
+ * Workers create their solver (caches and buffers) and their transposition table themselves after
+ * pinning, so the memory they touch first lands on their own node (Linux allocates pages on the node
+ * of the thread touching them). Only their small thread-local counters (tt_stamp, the --stats counters
+ * of -DSTATS builds) are initialized by the thread creating them, so they may be on its node.
+ * The topology (from /sys) and where the workers went are reported to stderr at the start.
+ */
+typedef enum placement {
+    PLACE_NONE, // wherever the scheduler puts them
+    PLACE_COMPACT,
+    PLACE_SCATTER,
+    NUM_PLACEMENTS
+} placement;
+
+const char* placement_names[] = { "none", "compact", "scatter" };
+placement selected_placement = PLACE_NONE;
+
+typedef struct cpu_info {
+    int cpu, node, package, core, thread; // thread: among the cpus of its core
+} cpu_info;
+
+cpu_info* placement_order; // cpus, in the order workers are placed on them
+int placement_cpus;
+
+static int read_sys_int(const char* fmt, int cpu, int fallback) {
+    char path[128];
+    int val;
+    snprintf(path, sizeof(path), fmt, cpu);
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return fallback;
+    if (fscanf(f, "%d", &val) != 1) val = fallback;
+    fclose(f);
+    return val;
+}
+
+// numa node of cpu, from the nodes' cpu lists (0 if there are none)
+static int cpu_node(int cpu) {
+    for (int node = 0; node < 256; node++) {
+        char path[64], list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* f = fopen(path, "r");
+        if (f == NULL) continue;
+        int found = 0;
+        if (fgets(list, sizeof(list), f) != NULL)
+            for (char* p = list; *p && *p != '\n'; p += *p == ',') { // "0-3,8-11"
+                int lo = strtol(p, &p, 10), hi = lo;
+                if (*p == '-') hi = strtol(p + 1, &p, 10);
+                if (cpu >= lo && cpu <= hi) found = 1;
+            }
+        fclose(f);
+        if (found) return node;
+    }
+    return 0;
+}
+
+static int cpu_compare(const void* a, const void* b) {
+    const cpu_info *x = a, *y = b;
+    if (x->node != y->node) return x->node - y->node;
+    if (x->thread != y->thread) return x->thread - y->thread;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+void placement_init(int nworkers) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        perror("sched_getaffinity");
+        selected_placement = PLACE_NONE;
+        return;
+    }
+    cpu_info* cpus = malloc(sizeof(cpu_info) * CPU_SETSIZE);
+    int n = 0, nodes = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        cpu_info c = { cpu, cpu_node(cpu), read_sys_int("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu, 0),
+                read_sys_int("/sys/devices/system/cpu/cpu%d/topology/core_id", cpu, cpu), 0 };
+        for (int i = 0; i < n; i++)
+            if (cpus[i].package == c.package && cpus[i].core == c.core) c.thread++;
+        if (c.node >= nodes) nodes = c.node + 1;
+        cpus[n++] = c;
+    }
+    qsort(cpus, n, sizeof(cpu_info), cpu_compare);
+    placement_order = malloc(sizeof(cpu_info) * n);
+    placement_cpus = n;
+    if (selected_placement == PLACE_COMPACT) {
+        memcpy(placement_order, cpus, sizeof(cpu_info) * n);
+    } else { // one of each node in turn
+        int* next = calloc(nodes, sizeof(int)), k = 0; // next: index into cpus, per node
+        for (int node = 0, i = 0; node < nodes; node++) {
+            next[node] = i;
+            while (i < n && cpus[i].node == node) i++;
+        }
+        while (k < n)
+            for (int node = 0; node < nodes; node++)
+                if (next[node] < n && cpus[next[node]].node == node) placement_order[k++] = cpus[next[node]++];
+        free(next);
+    }
+    free(cpus);
+
+    fprintf(stderr, "# placement %s: %d workers on %d cpus\n", placement_names[selected_placement], nworkers, n);
+    for (int node = 0; node < nodes; node++) {
+        int len = 0, count = 0;
+        char line[1024] = "";
+        for (int w = 0; w < nworkers && len < (int)sizeof(line) - 32; w++) {
+            const cpu_info* c = &placement_order[w % n];
+            if (c->node != node) continue;
+            len += snprintf(line + len, sizeof(line) - len, " %d->%d", w, c->cpu);
+            if (c->thread > 0) len += snprintf(line + len, sizeof(line) - len, "(ht)");
+            count++;
+        }
+        if (count > 0) fprintf(stderr, "# node %d: %d workers (worker->cpu):%s\n", node, count, line);
+    }
+    fprintf(stderr, "# node-local per worker: solver (cache, buffers), transposition table%s\n",
+            STATS_BUILD ? "; not: --stats counters (thread-local)" : "");
+}
+
+// pins the calling thread, worker i
+void placement_apply(int i) {
+    if (selected_placement == PLACE_NONE || placement_cpus == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(placement_order[i % placement_cpus].cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) fprintf(stderr, "# can't pin worker %d to cpu %d: %s\n", i, placement_order[i % placement_cpus].cpu, strerror(err));
+}
+
+/*
+ * Thread pool:
+ * every worker owns a deque of tasks. A task is either a range of options, or the sets
+ * of a single option that contain one of its 15 non-empty subsets of larges.
+ * The owner works on the bottom of its deque, splitting ranges in halves and pushing back
+ * the upper half, until a single option remains, which is split into its 15 subsets.
+ * Idle workers steal from the top of other deques, where the largest ranges are. If none of
+ * them has a task, they sleep until a task is pushed or the pool is done (instead of spinning
+ * through the tail of every run, taking cycles from the workers still computing).
+ * Results are added up per option (the sums don't depend on which worker computed which subset),
+ * the main thread prints them in order of the option index as soon as they are complete.
+ * With --dedup, the pool first runs over the jobs of the tier tables (same splitting, without subsets),
+ * then over the options, which are not split into subsets anymore.
+ * Options loaded from a checkpoint (pending < 0) are skipped.
+ */
+typedef struct task {
+    size_t lo, hi; // options [lo, hi) (or jobs, while computing the tier tables)
+    int mask; // 0: all sets of all options, else: only the sets of option lo containing the larges selected by mask
+} task;
+
+typedef struct deque {
+    pthread_mutex_t lock;
+    task* tasks;
+    size_t head, tail, cap; // tasks[head..tail) are queued, head is the top
+} __attribute__((aligned(64))) deque; // thieves write to it, keep it off the lines of other workers' fields
+
+typedef struct pool {
+    size_t start, end;
+    size_t* jobs; // not NULL while computing the tier tables
+    option_result* results; // indexed by option - start
+    int* pending; // subsets not yet added to results, per option (-1: loaded from the checkpoint)
+    size_t skipped; // options loaded from the checkpoint
+    size_t remaining; // options (or jobs) not yet complete
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_cond;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond; // idle workers wait on it
+    unsigned int pushes; // tasks pushed so far, idle workers sleep until it changes
+    int idle; // workers sleeping (or about to)
+    int nworkers;
+    int first; // placement index of the first worker
+    solver** solvers; // of the workers, created by them if NULL
+    struct worker* workers;
+} pool;
+
+typedef struct worker {
+    deque deque;
+    pthread_t thread;
+    int id;
+    pool* pool;
+    solver* sv; // private to this worker
+    unsigned int seed;
+} __attribute__((aligned(64))) worker; // a cache line of its own (the seed changes with every steal)
+
+void deque_push(deque* dq, task t) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->head == dq->tail) dq->head = dq->tail = 0;
+    if (dq->tail == dq->cap) {
+        dq->cap = dq->cap ? dq->cap * 2 : 64;
+        dq->tasks = realloc(dq->tasks, sizeof(task) * dq->cap);
+    }
+    dq->tasks[dq->tail++] = t;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+int deque_pop(deque* dq, task* t) { // bottom, owner only
+    pthread_mutex_lock(&dq->lock);
+    int ok = dq->head != dq->tail;
+    if (ok) *t = dq->tasks[--dq->tail];
+    pthread_mutex_unlock(&dq->lock);
+    return ok;
+}
+
+int deque_steal(deque* dq, task* t) { // top, any thread
+    pthread_mutex_lock(&dq->lock);
+    int ok = dq->head != dq->tail;
+    if (ok) *t = dq->tasks[dq->head++];
+    pthread_mutex_unlock(&dq->lock);
+    return ok;
+}
+
+// wakes up idle workers (all: the pool is done), if any
+static void pool_wake(pool* p, int all) {
+    if (__atomic_load_n(&p->idle, __ATOMIC_SEQ_CST) == 0) return;
+    pthread_mutex_lock(&p->idle_lock);
+    if (all) pthread_cond_broadcast(&p->idle_cond);
+    else pthread_cond_signal(&p->idle_cond);
+    pthread_mutex_unlock(&p->idle_lock);
+}
+
+static void pool_push(worker* w, task t) {
+    deque_push(&w->deque, t);
+    __atomic_add_fetch(&w->pool->pushes, 1, __ATOMIC_SEQ_CST);
+    pool_wake(w->pool, 0);
+}
+
+static void pool_done(pool* p) {
+    pthread_mutex_lock(&p->done_lock);
+    int last = __atomic_sub_fetch(&p->remaining, 1, __ATOMIC_SEQ_CST) == 0; // before looking at idle
+    pthread_cond_broadcast(&p->done_cond);
+    pthread_mutex_unlock(&p->done_lock);
+    if (last) pool_wake(p, 1);
+}
+
+void run_task(worker* w, task t) {
+    pool* p = w->pool;
+    if (t.mask == 0)
+        while (t.hi - t.lo > 1) { // split off upper halves for thieves
+            size_t mid = t.lo + (t.hi - t.lo) / 2;
+            pool_push(w, (task){ mid, t.hi, 0 });
+            t.hi = mid;
+        }
+    if (p->jobs != NULL) {
+        tiers_run_job(p->jobs[t.lo], w->sv);
+        pool_done(p);
+        return;
+    }
+    if (p->pending[t.lo - p->start] < 0) return;
+    if (t.mask == 0) {
+        if (dedup) {
+            t.mask = 15; // the rest is in the tier tables
+        } else {
+            for (int mask = 15; mask > 1; mask--)
+                pool_push(w, (task){ t.lo, t.hi, mask });
+            t.mask = 1;
+        }
+    }
+
+    int larges[4];
+    option_result res = { 0 };
+    option_larges(t.lo, larges);
+    iterate_subset(larges, t.mask, w->sv, &res);
+    if (dedup) tiers_lookup(larges, &res);
+
+    option_result* out = &p->results[t.lo - p->start];
+    for (int n = 0; n < 5; n++) {
+        __atomic_add_fetch(&out->sets[n], res.sets[n], __ATOMIC_RELAXED);
+        __atomic_add_fetch(&out->sols[n], res.sols[n], __ATOMIC_RELAXED);
+        __atomic_add_fetch(&out->exprs[n], res.exprs[n], __ATOMIC_RELAXED);
+    }
+    if (__atomic_sub_fetch(&p->pending[t.lo - p->start], 1, __ATOMIC_ACQ_REL) == 0)
+        pool_done(p);
+}
+
+void* worker_main(void* arg) {
+    worker* w = arg;
+    pool* p = w->pool;
+    task t;
+    placement_apply(p->first + w->id);
+    if (p->solvers[w->id] == NULL) p->solvers[w->id] = solver_new(); // on this worker's node
+    __atomic_store_n(&w->sv, p->solvers[w->id], __ATOMIC_RELEASE);
+    while (__atomic_load_n(&p->remaining, __ATOMIC_ACQUIRE) > 0) {
+        if (deque_pop(&w->deque, &t)) {
+            run_task(w, t);
+            continue;
+        }
+        unsigned int pushes = __atomic_load_n(&p->pushes, __ATOMIC_SEQ_CST);
+        int stolen = 0;
+        for (int i = 0; i < p->nworkers && !stolen; i++) {
+            worker* victim = &p->workers[(rand_r(&w->seed) + i) % p->nworkers];
+            if (victim != w) stolen = deque_steal(&victim->deque, &t);
+        }
+        if (stolen) {
+            run_task(w, t);
+            continue;
+        }
+        // nothing to steal: sleep until something is pushed after the deques were looked at
+        pthread_mutex_lock(&p->idle_lock);
+        __atomic_add_fetch(&p->idle, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&p->pushes, __ATOMIC_SEQ_CST) == pushes && __atomic_load_n(&p->remaining, __ATOMIC_SEQ_CST) > 0)
+            pthread_cond_wait(&p->idle_cond, &p->idle_lock);
+        __atomic_sub_fetch(&p->idle, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&p->idle_lock);
+    }
+    STAT(stats_merge());
+    tt_free();
+    return NULL;
+}
+
+// starts the workers on [lo, hi), split evenly between them
+void pool_start(pool* p, solver** solvers, size_t lo, size_t hi) {
+    p->remaining = hi - lo - p->skipped;
+    p->solvers = solvers;
+    p->pushes = p->idle = 0;
+    pthread_mutex_init(&p->idle_lock, NULL);
+    pthread_cond_init(&p->idle_cond, NULL);
+    if (posix_memalign((void**)&p->workers, 64, sizeof(worker) * p->nworkers) != 0) {
+        perror("posix_memalign");
+        exit(1);
+    }
+    memset(p->workers, 0, sizeof(worker) * p->nworkers);
+    for (int i = 0; i < p->nworkers; i++) {
+        worker* w = &p->workers[i];
+        w->id = i;
+        w->pool = p;
+        w->seed = i + 1;
+        w->sv = solvers[i]; // NULL: not created yet
+        pthread_mutex_init(&w->deque.lock, NULL);
+        size_t tlo = lo + (hi - lo) * i / p->nworkers, thi = lo + (hi - lo) * (i + 1) / p->nworkers;
+        if (tlo < thi) deque_push(&w->deque, (task){ tlo, thi, 0 });
+    }
+    for (int i = 0; i < p->nworkers; i++)
+        pthread_create(&p->workers[i].thread, NULL, worker_main, &p->workers[i]);
+}
+
+// waits until option idx is complete
+void pool_wait(pool* p, size_t idx) {
+    pthread_mutex_lock(&p->done_lock);
+    while (__atomic_load_n(&p->pending[idx - p->start], __ATOMIC_ACQUIRE) > 0)
+        pthread_cond_wait(&p->done_cond, &p->done_lock);
+    pthread_mutex_unlock(&p->done_lock);
+}
+
+void pool_join(pool* p) {
+    for (int i = 0; i < p->nworkers; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+        pthread_mutex_destroy(&p->workers[i].deque.lock);
+        free(p->workers[i].deque.tasks);
+    }
+    free(p->workers);
+    p->workers = NULL;
+    pthread_mutex_destroy(&p->idle_lock);
+    pthread_cond_destroy(&p->idle_cond);
+}
+
+/*
+ * Process pool (--procs N):
+ * the options are computed by N forked worker processes (with '--threads' threads each,
+ * 1 by default) instead of threads of this one. After the tier tables (computed by this
+ * process with all N * threads threads, then shared with the workers copy-on-write),
+ * every worker gets a range of options over a pipe (smaller ones towards the end, at most
+ * PROCS_MAX_CHUNK options), computes it with its own thread pool and sends back a
+ * proc_report per option over another pipe, then gets the next range.
+ * The results end up in the same arrays as with threads, so printing, checkpoints and the
+ * final report don't change. Once no ranges are left, the workers report their cache (and stats)
+ * counters and exit. A worker that dies is replaced by a new one computing the rest of its range,
+ * up to PROCS_RETRIES times in a row for the same range.
+ */
+#define PROCS_MAX_CHUNK 64
+#define PROCS_RETRIES 3
+
+int nprocs = 1;
+
+typedef struct proc_report {
+    size_t idx; // SIZE_MAX: the worker is done, counters follow
+    option_result res;
+    unsigned long long games; // solved since the last report
+    unsigned long long hits, misses, evictions; // of the worker's caches
+#ifdef STATS
+    stats st[5];
+#endif
+} proc_report;
+
+typedef struct proc {
+    pid_t pid; // 0: exited
+    int cmd, rep; // pipes: ranges to the worker, reports from it (-1: closed)
+    size_t lo, hi; // options of the range not reported yet
+    int failures; // restarts since the last completed range
+    unsigned long long games; // solved, as reported
+} proc;
+
+typedef struct procs {
+    size_t start, end, next; // options [next, end) aren't handed out yet
+    size_t done; // options reported
+    option_result* results;
+    int* pending;
+    solver** solvers;
+    int nprocs, nthreads;
+    proc* procs;
+    cache cstats; // counters reported by the workers
+} procs;
+
+// reads exactly len bytes, returns 0 on end of file (or error)
+static int read_full(int fd, void* buf, size_t len) {
+    for (size_t done = 0; done < len;) {
+        ssize_t got = read(fd, (char*)buf + done, len - done);
+        if (got <= 0) return 0;
+        done += got;
+    }
+    return 1;
+}
+
+// a worker process: computes the ranges read from cmd, reports to rep
+static void proc_main(procs* ps, int index, int cmd, int rep) {
+    solver** solvers = ps->solvers + index * ps->nthreads; // the ones its threads had computing the tier tables
+    size_t range[2];
+    proc_report r = { 0 };
+    unsigned long long reported = 0;
+    signal(SIGUSR1, SIG_IGN); // progress reports are the main process's
+    STAT(memset(&total_stats, 0, sizeof(total_stats))); // these were this process's parent's
+    for (int i = 0; i < ps->nthreads; i++)
+        if (solvers[i] != NULL) solvers[i]->cache.hits = solvers[i]->cache.misses = solvers[i]->cache.evictions = 0;
+    while (read_full(cmd, range, sizeof(range))) {
+        pool p = { .start = range[0], .end = range[1], .nworkers = ps->nthreads, .first = index * ps->nthreads };
+        pthread_mutex_init(&p.done_lock, NULL);
+        pthread_cond_init(&p.done_cond, NULL);
+        p.results = calloc(p.end - p.start, sizeof(option_result));
+        p.pending = malloc(sizeof(int) * (p.end - p.start));
+        for (size_t idx = p.start; idx < p.end; idx++) {
+            p.pending[idx - p.start] = ps->pending[idx - ps->start] > 0 ? (dedup ? 1 : 15) : -1;
+            if (p.pending[idx - p.start] < 0) p.skipped++;
+        }
+        pool_start(&p, solvers, p.start, p.end);
+        for (size_t idx = p.start; idx < p.end; idx++) {
+            if (p.pending[idx - p.start] < 0) continue;
+            pool_wait(&p, idx);
+            r.idx = idx;
+            r.res = p.results[idx - p.start];
+            r.games = 0;
+            for (int i = 0; i < ps->nthreads; i++) r.games += solvers[i] != NULL ? solvers[i]->games : 0;
+            r.games -= reported;
+            reported += r.games;
+            if (write(rep, &r, sizeof(r)) != sizeof(r)) _exit(1);
+        }
+        pool_join(&p);
+        free(p.results);
+        free(p.pending);
+        pthread_mutex_destroy(&p.done_lock);
+        pthread_cond_destroy(&p.done_cond);
+    }
+    r.idx = SIZE_MAX;
+    for (int i = 0; i < ps->nthreads; i++)
+        if (solvers[i] != NULL) {
+            r.hits += solvers[i]->cache.hits;
+            r.misses += solvers[i]->cache.misses;
+            r.evictions += solvers[i]->cache.evictions;
+        }
+    STAT(memcpy(r.st, total_stats, sizeof(r.st)));
+    if (write(rep, &r, sizeof(r)) != sizeof(r)) _exit(1);
+    _exit(0);
+}
+
+// forks the worker of slot pr
+static void proc_spawn(procs* ps, proc* pr) {
+    int cmd[2], rep[2];
+    if (pipe(cmd) != 0 || pipe(rep) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    fflush(NULL); // or the buffers would be written twice
+    pr->pid = fork();
+    if (pr->pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pr->pid == 0) {
+        for (int i = 0; i < ps->nprocs; i++) { // the others would never see their pipes closed
+            if (ps->procs[i].cmd >= 0) close(ps->procs[i].cmd);
+            if (ps->procs[i].rep >= 0) close(ps->procs[i].rep);
+        }
+        close(cmd[1]);
+        close(rep[0]);
+        proc_main(ps, pr - ps->procs, cmd[0], rep[1]);
+    }
+    close(cmd[0]);
+    close(rep[1]);
+    pr->cmd = cmd[1];
+    pr->rep = rep[0];
+}
+
+// skips the options of the worker's range that are complete, hands out the next range once it is empty
+static void proc_next(procs* ps, proc* pr) {
+    for (;;) {
+        while (pr->lo < pr->hi && ps->pending[pr->lo - ps->start] <= 0) pr->lo++;
+        if (pr->lo < pr->hi) return;
+        pr->failures = 0;
+        if (ps->next == ps->end) break;
+        size_t chunk = (ps->end - ps->next) / (ps->nprocs * 4);
+        if (chunk < 1) chunk = 1;
+        if (chunk > PROCS_MAX_CHUNK) chunk = PROCS_MAX_CHUNK;
+        pr->lo = ps->next;
+        pr->hi = ps->next += chunk;
+        while (pr->lo < pr->hi && ps->pending[pr->lo - ps->start] <= 0) pr->lo++;
+        size_t range[2] = { pr->lo, pr->hi };
+        if (pr->lo < pr->hi && write(pr->cmd, range, sizeof(range)) != sizeof(range))
+            return; // it died, which its reports pipe tells
+    }
+    if (pr->cmd >= 0) close(pr->cmd); // no ranges left, the worker reports its counters and exits
+    pr->cmd = -1;
+}
+
+// a worker closed its reports pipe (exited or died)
+static void proc_exited(procs* ps, proc* pr, int reported) {
+    int status;
+    close(pr->rep);
+    pr->rep = -1;
+    if (pr->cmd >= 0) close(pr->cmd);
+    pr->cmd = -1;
+    waitpid(pr->pid, &status, 0);
+    pr->pid = 0;
+    if (reported) return;
+    if (pr->lo == pr->hi) {
+        fprintf(stderr, "# worker %d died after its last range, its counters are lost\n", (int)(pr - ps->procs));
+        return;
+    }
+    if (++pr->failures > PROCS_RETRIES) {
+        fprintf(stderr, "worker %d died %d times computing options %zu to %zu, giving up\n", (int)(pr - ps->procs), pr->failures, pr->lo, pr->hi);
+        exit(1);
+    }
+    fprintf(stderr, "# worker %d died computing options %zu to %zu, restarting it\n", (int)(pr - ps->procs), pr->lo, pr->hi);
+    proc_spawn(ps, pr);
+    size_t range[2] = { pr->lo, pr->hi };
+    if (write(pr->cmd, range, sizeof(range)) != sizeof(range)) return;
+}
+
+// waits for reports of any worker and handles them, returns 0 once all workers exited
+static int procs_poll(procs* ps) {
+    struct pollfd fds[ps->nprocs];
+    int nfds = 0;
+    for (int i = 0; i < ps->nprocs; i++)
+        if (ps->procs[i].rep >= 0) fds[nfds++] = (struct pollfd){ .fd = ps->procs[i].rep, .events = POLLIN };
+    if (nfds == 0) return 0;
+    if (poll(fds, nfds, -1) < 0) return 1;
+    for (int f = 0, i = 0; f < nfds; f++) {
+        while (ps->procs[i].rep != fds[f].fd) i++;
+        proc* pr = &ps->procs[i];
+        if (!(fds[f].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+        proc_report r;
+        if (!read_full(pr->rep, &r, sizeof(r))) {
+            proc_exited(ps, pr, 0);
+        } else if (r.idx == SIZE_MAX) {
+            ps->cstats.hits += r.hits;
+            ps->cstats.misses += r.misses;
+            ps->cstats.evictions += r.evictions;
+            STAT(stats_add(total_stats, r.st));
+            proc_exited(ps, pr, 1);
+        } else if (r.idx >= pr->lo && r.idx < pr->hi) {
+            ps->results[r.idx - ps->start] = r.res;
+            ps->pending[r.idx - ps->start] = 0;
+            __atomic_store_n(&pr->games, pr->games + r.games, __ATOMIC_RELAXED);
+            __atomic_store_n(&ps->done, ps->done + 1, __ATOMIC_RELAXED);
+            proc_next(ps, pr);
+        }
+    }
+    return 1;
+}
+
+// forks the workers on the options of [start, end) that are still pending
+void procs_start(procs* ps, size_t start, size_t end, option_result* results, int* pending, solver** solvers, int nprocs, int nthreads) {
+    *ps = (procs){ .start = start, .end = end, .next = start, .results = results, .pending = pending, .solvers = solvers, .nprocs = nprocs, .nthreads = nthreads };
+    ps->procs = malloc(sizeof(proc) * nprocs);
+    for (int i = 0; i < nprocs; i++)
+        ps->procs[i] = (proc){ .cmd = -1, .rep = -1 };
+    signal(SIGPIPE, SIG_IGN); // writing to a dead worker fails instead
+    for (int i = 0; i < nprocs; i++) {
+        proc_spawn(ps, &ps->procs[i]);
+        proc_next(ps, &ps->procs[i]);
+    }
+}
+
+// waits until option idx is complete
+void procs_wait(procs* ps, size_t idx) {
+    while (ps->pending[idx - ps->start] > 0 && procs_poll(ps));
+}
+
+void procs_join(procs* ps) {
+    while (procs_poll(ps));
+    free(ps->procs);
+    ps->procs = NULL;
+}
+
+/*
+ * Progress (--progress N, --status file, SIGUSR1):
+ * a thread reporting how far the computation is every N seconds: wall clock time since the start of the phase
+ * (computing the tier tables, then the options), options done (or tier jobs), games solved per second and
+ * per worker (thread, or process with --procs) since the last report, options per second and the time
+ * left at that rate since the start of the phase, and the results of the options printed so far (solutions
+ * and sets per amount of larges, added up like the final report). With --progress, the report goes to stderr, with --status,
+ * the file is replaced by one with a 'key value' line per number (every PROGRESS_STATUS_SECONDS, unless
+ * --progress is given). SIGUSR1 triggers a report to both right away, so a long run can be checked on
+ * without stopping it. A report costs the workers nothing: they only count the games they solve
+ * (worker processes report them with every option, so their rates are only as smooth as that).
+ */
+#define PROGRESS_STATUS_SECONDS 10
+
+int progress_seconds = 0;
+const char* status_path = NULL;
+volatile sig_atomic_t progress_requested = 0;
+
+typedef struct progress {
+    pthread_t thread;
+    pthread_mutex_t lock; // phase
+    int running, stop;
+    const char* phase;
+    double start, last; // wall time of the start of the phase and of the last report
+    size_t total; // options (or jobs) of the phase
+    pool* pool; // threads: done = total - remaining
+    procs* procs; // processes: done is counted (both NULL: between phases, nothing to report)
+    unsigned long long games, last_games[64]; // at the last report, in total and of the first 64 workers
+    size_t printed; // options printed so far (all phases)
+    option_result results; // their results added up
+} progress;
+
+// adds the results of a printed option to the aggregates of the reports
+void progress_add(progress* pr, const option_result* res) {
+    pthread_mutex_lock(&pr->lock);
+    pr->printed++;
+    for (int n = 0; n < 5; n++) {
+        pr->results.sets[n] += res->sets[n];
+        pr->results.sols[n] += res->sols[n];
+    }
+    pthread_mutex_unlock(&pr->lock);
+}
+
+static void progress_signal(int sig) {
+    (void)sig;
+    progress_requested = 1;
+}
+
+static unsigned long long progress_games(worker* w) {
+    solver* sv = __atomic_load_n(&w->sv, __ATOMIC_ACQUIRE); // NULL until the worker created it
+    return sv != NULL ? __atomic_load_n(&sv->games, __ATOMIC_RELAXED) : 0;
+}
+
+static void format_duration(char* buf, size_t len, double seconds) {
+    long s = seconds < 0 ? 0 : (long)seconds;
+    snprintf(buf, len, "%ld:%02ld:%02ld", s / 3600, s / 60 % 60, s % 60);
+}
+
+static void progress_report(progress* pr, int to_stderr, int to_status) {
+    char elapsed[32], eta[32], workers[64 * 12] = "";
+    double now = wall_time(), dt = now - pr->last;
+    pthread_mutex_lock(&pr->lock);
+    if (pr->pool == NULL && pr->procs == NULL) {
+        pthread_mutex_unlock(&pr->lock);
+        return;
+    }
+    size_t done = pr->procs != NULL ? __atomic_load_n(&pr->procs->done, __ATOMIC_RELAXED)
+            : pr->total - __atomic_load_n(&pr->pool->remaining, __ATOMIC_RELAXED);
+    int nworkers = pr->procs != NULL ? pr->procs->nprocs : pr->pool->nworkers, len = 0;
+    unsigned long long games = 0;
+    for (int i = 0; i < nworkers; i++) {
+        unsigned long long g = pr->procs != NULL ? __atomic_load_n(&pr->procs->procs[i].games, __ATOMIC_RELAXED)
+                : progress_games(&pr->pool->workers[i]);
+        games += g;
+        if (i < 64) {
+            len += snprintf(workers + len, sizeof(workers) - len, "%s%.0f", i ? "," : "", dt > 0 ? (g - pr->last_games[i]) / dt : 0);
+            pr->last_games[i] = g;
+        }
+    }
+    double rate = now > pr->start ? done / (now - pr->start) : 0, games_rate = dt > 0 ? (games - pr->games) / dt : 0;
+    format_duration(elapsed, sizeof(elapsed), now - pr->start);
+    if (done > 0) format_duration(eta, sizeof(eta), (pr->total - done) / rate);
+    else strcpy(eta, "?");
+    const option_result* r = &pr->results;
+    if (to_stderr) {
+        fprintf(stderr, "# %s: %zu/%zu (%.1f%%) after %s, %.1f/s, %.0f games/s (per worker: %s), eta %s\n", pr->phase, done, pr->total,
+                pr->total ? 100.0 * done / pr->total : 100.0, elapsed, rate, games_rate, workers, eta);
+        if (pr->printed > 0) {
+            fprintf(stderr, "# results of %zu options so far (solutions/sets):", pr->printed);
+            for (int n = 1; n < 5; n++)
+                fprintf(stderr, " %d large%s %llu/%llu (%.3f%%)%s", n, n == 1 ? "" : "s", r->sols[n], r->sets[n],
+                        100.0 * r->sols[n] / (r->sets[n] * NUM_TARGETS), n < 4 ? "," : "\n");
+        }
+    }
+    if (to_status) {
+        char tmp[4096];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", status_path);
+        FILE* f = fopen(tmp, "w");
+        if (f != NULL) {
+            fprintf(f, "phase %s\nelapsed_s %.3f\ndone %zu\ntotal %zu\nper_s %.3f\neta_s %.0f\ngames %llu\ngames_per_s %.0f\nworker_games_per_s %s\n",
+                    pr->phase, now - pr->start, done, pr->total, rate, done > 0 ? (pr->total - done) / rate : -1.0, games, games_rate, workers);
+            fprintf(f, "options_printed %zu\n", pr->printed);
+            for (int n = 1; n < 5; n++)
+                fprintf(f, "sols_%d %llu\nsets_%d %llu\n", n, r->sols[n], n, r->sets[n]);
+            fclose(f);
+            if (rename(tmp, status_path) != 0) perror(status_path);
+        } else {
+            perror(tmp);
+        }
+    }
+    pr->games = games;
+    pr->last = now;
+    pthread_mutex_unlock(&pr->lock);
+}
+
+static void* progress_main(void* arg) {
+    progress* pr = arg;
+    int every = progress_seconds > 0 ? progress_seconds : PROGRESS_STATUS_SECONDS;
+    double next = wall_time() + every;
+    while (!__atomic_load_n(&pr->stop, __ATOMIC_ACQUIRE)) {
+        struct timespec ts = { 0, 100000000 };
+        nanosleep(&ts, NULL);
+        if (progress_requested) {
+            progress_requested = 0;
+            progress_report(pr, 1, status_path != NULL);
+        } else if (wall_time() >= next && (progress_seconds > 0 || status_path != NULL)) {
+            progress_report(pr, progress_seconds > 0, status_path != NULL);
+        } else {
+            continue;
+        }
+        next = wall_time() + every;
+    }
+    return NULL;
+}
+
+// starts reporting a phase of total options (or jobs), computed by pool p (threads) or ps (processes)
+void progress_phase(progress* pr, const char* phase, size_t total, pool* p, procs* ps) {
+    pthread_mutex_lock(&pr->lock);
+    pr->phase = phase;
+    pr->total = total;
+    pr->pool = p;
+    pr->procs = ps;
+    pr->start = pr->last = wall_time();
+    pr->games = 0;
+    memset(pr->last_games, 0, sizeof(pr->last_games));
+    for (int i = 0; p != NULL && ps == NULL && i < p->nworkers; i++) {
+        pr->games += progress_games(&p->workers[i]);
+        if (i < 64) pr->last_games[i] = progress_games(&p->workers[i]);
+    }
+    pthread_mutex_unlock(&pr->lock);
+    if (!pr->running) {
+        pr->running = 1;
+        struct sigaction sa = { .sa_handler = progress_signal, .sa_flags = SA_RESTART };
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGUSR1, &sa, NULL);
+        pthread_create(&pr->thread, NULL, progress_main, pr);
+    }
+}
+
+// stops the reporter before the pools go away, with a last report
+void progress_stop(progress* pr) {
+    if (!pr->running) return;
+    __atomic_store_n(&pr->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(pr->thread, NULL);
+    pr->running = 0;
+    if (progress_seconds > 0 || status_path != NULL) progress_report(pr, progress_seconds > 0, status_path != NULL);
+    signal(SIGUSR1, SIG_IGN);
+    pthread_mutex_destroy(&pr->lock);
+}
+
+void iterate_sets(size_t start, size_t end, int nthreads) {
+    int nsolvers = nthreads * nprocs; // the tier tables are computed by this process alone
+    pool p = { .start = start, .end = end, .nworkers = nsolvers };
+    procs ps;
+    progress prog = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    pthread_mutex_init(&p.done_lock, NULL);
+    pthread_cond_init(&p.done_cond, NULL);
+    solver** solvers = calloc(nsolvers, sizeof(solver*)); // created by the workers
+    if (selected_placement != PLACE_NONE) placement_init(nsolvers);
+
+    p.results = calloc(end - start, sizeof(option_result));
+    p.pending = malloc(sizeof(int) * (end - start));
+    for (size_t i = 0; i < end - start; i++) p.pending[i] = dedup ? 1 : 15;
+    size_t resumed = checkpoint_path != NULL ? checkpoint_open(start, end, p.results, p.pending) : 0;
+    if (store_path != NULL)
+        results_store = store_create(store_path, start, end, store_games ? STORE_GAMES : 0);
+    if (checkpoint_path != NULL)
+        fprintf(stderr, "# resumed %zu of %zu options from %s\n", resumed, end - start, checkpoint_path);
+
+    if (dedup) {
+        tiers_init();
+        size_t njobs = tiers_jobs(start, end, p.pending, &p.jobs);
+        pool_start(&p, solvers, 0, njobs);
+        progress_phase(&prog, "tier tables", njobs, &p, NULL);
+        pthread_mutex_lock(&p.done_lock);
+        while (p.remaining > 0)
+            pthread_cond_wait(&p.done_cond, &p.done_lock);
+        pthread_mutex_unlock(&p.done_lock);
+        progress_phase(&prog, "tier tables", njobs, NULL, NULL); // the workers are about to go
+        pool_join(&p);
+        free(p.jobs);
+        p.jobs = NULL;
+        fprintf(stderr, "# computed the sets of %zu distinct subsets of 1 to 3 larges\n", njobs);
+    }
+
+    p.skipped = resumed;
+    p.nworkers = nthreads;
+    if (nprocs > 1) procs_start(&ps, start, end, p.results, p.pending, solvers, nprocs, nthreads);
+    else pool_start(&p, solvers, start, end);
+    progress_phase(&prog, "options", end - start - resumed, &p, nprocs > 1 ? &ps : NULL);
+
+    // one line per option: index, larges, solvable games per amount of larges (1..4), sets per amount of larges (1..4), percentage solvable
+    printf("# option l1 l2 l3 l4 sol1 sol2 sol3 sol4 set1 set2 set3 set4 percent\n");
+    option_result total = { 0 };
+    for (size_t idx = start; idx < end; idx++) {
+        if (nprocs > 1) procs_wait(&ps, idx);
+        else pool_wait(&p, idx);
+
+        int larges[4];
+        option_result* res = &p.results[idx - start];
+        option_larges(idx, larges);
+        print_option(stdout, idx, larges, res);
+        if (checkpoint != NULL && p.pending[idx - start] == 0) checkpoint_write(idx, larges, res);
+        if (results_store != NULL) store_option(results_store, idx, res);
+        for (int n = 0; n < 5; n++) {
+            total.sets[n] += res->sets[n];
+            total.sols[n] += res->sols[n];
+            total.exprs[n] += res->exprs[n];
+        }
+        progress_add(&prog, res);
+    }
+
+    progress_stop(&prog);
+    if (nprocs > 1) procs_join(&ps);
+    else pool_join(&p);
+    if (start == 0) { // the games without larges are the same for every option, the first range computes them once
+        solver* sv = solver_new();
+        iterate_games(NULL, 0, sv, &total);
+        solver_free(sv);
+        STAT(stats_merge()); // this thread's counters, like a worker's
+    }
+    if (checkpoint != NULL) checkpoint_close();
+    if (results_store != NULL) {
+        store_close(results_store);
+        results_store = NULL;
+    }
+    cache cstats = { 0 };
+    if (nprocs > 1) cstats = ps.cstats;
+    for (int i = 0; i < nsolvers; i++) {
+        if (solvers[i] == NULL) continue;
+        cstats.hits += solvers[i]->cache.hits;
+        cstats.misses += solvers[i]->cache.misses;
+        cstats.evictions += solvers[i]->cache.evictions;
+        solver_free(solvers[i]);
+    }
+    free(solvers);
+    if (dedup) tiers_free();
+    free(p.results);
+    free(p.pending);
+    pthread_mutex_destroy(&p.done_lock);
+    pthread_cond_destroy(&p.done_cond);
+
+    unsigned long long total_sets = total.sets[1] + total.sets[2] + total.sets[3] + total.sets[4];
+    unsigned long long total_sols = total.sols[1] + total.sols[2] + total.sols[3] + total.sols[4];
+    if (total.sets[0] > 0)
+        printf("found %llu solutions for %llu sets with 0 large numbers (%.3f%%)\n", total.sols[0], total.sets[0], 100.0*total.sols[0]/(total.sets[0]*NUM_TARGETS));
+    printf("found %llu solutions for %llu sets with 1 large number  (%.3f%%)\n", total.sols[1], total.sets[1], 100.0*total.sols[1]/(total.sets[1]*NUM_TARGETS));
+    printf("found %llu solutions for %llu sets with 2 large numbers (%.3f%%)\n", total.sols[2], total.sets[2], 100.0*total.sols[2]/(total.sets[2]*NUM_TARGETS));
+    printf("found %llu solutions for %llu sets with 3 large numbers (%.3f%%)\n", total.sols[3], total.sets[3], 100.0*total.sols[3]/(total.sets[3]*NUM_TARGETS));
+    printf("found %llu solutions for %llu sets with 4 large numbers (%.3f%%)\n", total.sols[4], total.sets[4], 100.0*total.sols[4]/(total.sets[4]*NUM_TARGETS));
+    printf("found %llu total solutions for %llu total sets (%.3f%%)\n", total_sols, total_sets, 100.0*total_sols/(total_sets*NUM_TARGETS));
+    if (count_expressions)
+        for (int n = total.sets[0] > 0 ? 0 : 1; n < 5; n++)
+            printf("counted %llu expressions reaching a target in the sets with %d large number%s\n", total.exprs[n], n, n == 1 ? "" : "s");
+    if (selected_engine != ENGINE_SEARCH && cache_max_bytes > 0)
+        fprintf(stderr, "# cache: %llu hits, %llu misses, %llu evictions (%.3f%% hit rate)\n", cstats.hits, cstats.misses, cstats.evictions,
+                100.0*cstats.hits/(cstats.hits + cstats.misses));
+}
+
+/*
+ * Query server (--serve file [--socket path]):
+ * answers queries from a results store (see --store), one line each, without computing anything:
+ * - 'o <option>' or 'o a,b,c,d': the result line of the option, like the ones printed by a run
+ * - 'r a,b,c,d,e,f t': '1' if target t can be reached in the game, else '0' (needs --store-games)
+ * - anything else, or something the store doesn't hold: 'e <reason>'
+ * Queries are read in batches (whatever arrived so far) and all their answers are written at once.
+ * Without --socket, queries come from stdin and answers go to stdout, else every connection to the
+ * unix socket at path gets its own thread.
+ * Games are found by the position of their small numbers in the order iterate_games computes them,
+ * which is listed once at startup (without solving anything).
+ */
+#define SMALLS_KEYS 59049 // 3^10: amount of times (0..2) each small number appears
+
+int game_index[5][SMALLS_KEYS]; // [larges][smalls key]: row in small_games, -1: no such game
+
+static int smalls_key(const int* vals, int size) {
+    int key = 0;
+    for (int i = 0; i < size; i++) {
+        if (vals[i] > SMALL_MAX) continue;
+        int pow = 1;
+        for (int v = 1; v < vals[i]; v++) pow *= 3;
+        key += pow;
+    }
+    return key;
+}
+
+void game_index_init() {
+    memset(game_index, -1, sizeof(game_index));
+    for (int n = 1; n < 5; n++)
+        for (int g = 0; g < (int)subset_games[n]; g++) {
+            int vals[6];
+            for (int i = 0; i < 6 - n; i++) vals[i] = small_games[n][g].val[i];
+            game_index[n][smalls_key(vals, 6 - n)] = g;
+        }
+}
+
+// the targets of a game in the store, NULL (and *err set) if it isn't there
+static const unsigned long long* store_game(const store* st, const int* vals, int size, const char** err) {
+    int larges[4], n = 0, seen[MAX_LARGE + 1] = { 0 };
+    if (size != 6) return *err = "a game has 6 numbers", NULL;
+    for (int i = 0; i < size; i++) {
+        if (vals[i] < 1 || vals[i] > MAX_LARGE) return *err = "numbers are 1..100", NULL;
+        if (vals[i] > SMALL_MAX) {
+            if (seen[vals[i]]++ || n == 4) return *err = "at most 4 distinct large numbers", NULL;
+            for (int k = n++; k >= 0; k--) // insert sorted ascending
+                if (k == 0 || larges[k - 1] < vals[i]) {
+                    larges[k] = vals[i];
+                    break;
+                } else larges[k] = larges[k - 1];
+        } else if (seen[vals[i]]++ == 2) return *err = "small numbers appear at most twice", NULL;
+    }
+    if (n == 0) return *err = "games without large numbers aren't stored", NULL;
+    if (st->games[n] == NULL) return *err = "the store has no games (--store-games)", NULL;
+    size_t rec = n < 4 ? subset_index(larges, n) : option_index(larges);
+    if (n == 4 && (rec < st->hdr->start || rec >= st->hdr->end)) return *err = "option not in the store", NULL;
+    if (n == 4) rec -= st->hdr->start;
+    const unsigned long long* bits = st->games[n] + (rec * subset_games[n] + game_index[n][smalls_key(vals, size)]) * SOLBITS_WORDS;
+    for (int i = 0; i < SOLBITS_WORDS; i++)
+        if (bits[i]) return bits;
+    return *err = "game not computed", NULL;
+}
+
+// answers a single query (a line without the newline), returns the length of the answer
+// reads a number (digits only) at *p, moving *p past it, returns 0 if there is none
+static int serve_number(char** p, int* val) {
+    char* end;
+    if (**p < '0' || **p > '9') return 0;
+    long v = strtol(*p, &end, 10);
+    if (v > 0x7fffffff) return 0;
+    *val = (int)v;
+    *p = end;
+    return 1;
+}
+
+static int serve_query(const store* st, char* query, char* out, size_t len) {
+    int vals[8], nvals = 0, target = 0, has_target = 0;
+    char* p = query + 1;
+    if (query[0] == '\0' || *p != ' ') return snprintf(out, len, "e unknown query\n");
+    while (*p == ' ') p++;
+    do { // comma separated numbers, then maybe a target
+        if (nvals == 8 || !serve_number(&p, &vals[nvals++])) return snprintf(out, len, "e malformed query\n");
+    } while (*p == ',' && p++);
+    if (*p == ' ') {
+        while (*p == ' ') p++;
+        if (*p != '\0' && *p != '\r' && !(has_target = serve_number(&p, &target))) return snprintf(out, len, "e malformed query\n");
+    }
+    while (*p == ' ' || *p == '\r') p++;
+    if (*p != '\0') return snprintf(out, len, "e malformed query\n");
+
+    if (query[0] == 'o' && (nvals == 1 || nvals == 4) && !has_target) {
+        int larges[4];
+        size_t idx = vals[0];
+        if (nvals == 4) {
+            for (int j = 0; j < 4; j++) larges[j] = vals[j];
+            for (int j = 1; j < 4; j++) // sort ascending
+                for (int k = j; k > 0 && larges[k - 1] > larges[k]; k--) {
+                    int tmp = larges[k];
+                    larges[k] = larges[k - 1];
+                    larges[k - 1] = tmp;
+                }
+            for (int j = 0; j < 4; j++)
+                if (larges[j] < MIN_LARGE || larges[j] > MAX_LARGE || (j > 0 && larges[j] == larges[j - 1]))
+                    return snprintf(out, len, "e not an option\n");
+            idx = option_index(larges);
+        }
+        if (vals[0] < 0 || idx < st->hdr->start || idx >= st->hdr->end) return snprintf(out, len, "e option not in the store\n");
+        size_t rec = idx - st->hdr->start;
+        if (st->sols[1][rec] == 0) return snprintf(out, len, "e option not computed\n");
+        option_result res = { 0 };
+        for (int n = 1; n < 5; n++) {
+            res.sols[n] = st->sols[n][rec];
+            res.sets[n] = st->hdr->sets[n] * binom(4, n);
+        }
+        option_larges(idx, larges);
+        return format_option(out, len, idx, larges, &res);
+    }
+    if (query[0] == 'r' && nvals == 6 && has_target) {
+        const char* err;
+        const unsigned long long* bits = store_game(st, vals, nvals, &err);
+        if (bits == NULL) return snprintf(out, len, "e %s\n", err);
+        unsigned int idx = target - MIN_TARGET;
+        return snprintf(out, len, "%d\n", idx < NUM_TARGETS && (bits[idx >> 6] >> (idx & 63) & 1));
+    }
+    return snprintf(out, len, "e unknown query\n");
+}
+
+// answers all queries from fd in, writing to fd out, until in is closed
+void serve_fd(const store* st, int in, int out) {
+    static const size_t bufsize = 1 << 16;
+    char* buf = malloc(bufsize);
+    char* ans = malloc(bufsize);
+    size_t have = 0;
+    ssize_t got;
+    while ((got = read(in, buf + have, bufsize - 1 - have)) > 0) {
+        size_t used = 0, alen = 0;
+        have += got;
+        for (char* nl; (nl = memchr(buf + used, '\n', have - used)) != NULL; used = nl + 1 - buf) {
+            *nl = '\0';
+            if (bufsize - alen < 256) { // answers are shorter
+                if (write(out, ans, alen) != (ssize_t)alen) goto done;
+                alen = 0;
+            }
+            alen += serve_query(st, buf + used, ans + alen, bufsize - alen);
+        }
+        if (alen > 0 && write(out, ans, alen) != (ssize_t)alen) break;
+        memmove(buf, buf + used, have - used);
+        have -= used;
+        if (have == bufsize - 1) have = 0; // a line longer than the buffer isn't a query
+    }
+done:
+    free(buf);
+    free(ans);
+}
+
+typedef struct connection {
+    const store* st;
+    int fd;
+} connection;
+
+static void* serve_connection(void* arg) {
+    connection* c = arg;
+    serve_fd(c->st, c->fd, c->fd);
+    close(c->fd);
+    free(c);
+    return NULL;
+}
+
+void serve_socket(const store* st, const char* path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        perror(path);
+        exit(1);
+    }
+    for (;;) {
+        int cfd = accept(fd, NULL, NULL);
+        if (cfd < 0) continue;
+        connection* c = malloc(sizeof(connection));
+        c->st = st;
+        c->fd = cfd;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve_connection, c) != 0) {
+            close(cfd);
+            free(c);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+/*
+ * Verification (--verify N [--seed S]):
+ * solves N random games (seeded, so a run can be repeated) of the computed options with the selected
+ * engine (and kernel, pruning, ...) and with solution_set_ref, the plain search that tries every pair and
+ * every operation and recurses into every result, without any of the optimizations. Their targets have to
+ * be the same, game by game. Each game that differs is shrunk: numbers are left out as long as the rest still
+ * differs. The smallest of these (fewest numbers, then smallest numbers) is reported, with the targets that differ.
+ */
+int solution_set_ref(solbits* sols, const gamestate* set) {
+    for (int i = 0; i < set->size; i++)
+        for (int j = i + 1; j < set->size; j++) {
+            long long a = set->val[i], b = set->val[j], res[NUM_OPS] = { a + b, a - b, a * b, a % b == 0 ? a / b : 0 };
+            for (int op = 0; op < NUM_OPS; op++) {
+                if (res[op] <= 0 || res[op] > 0x7fffffff) continue;
+                if (solbits_mark(sols, res[op])) return 1;
+                if (set->size == 2) continue;
+                gamestate mut = { .size = 0 };
+                for (int k = 0; k < set->size; k++)
+                    if (k != i && k != j) mut.val[mut.size++] = set->val[k];
+                gs_insert(&mut, res[op]);
+                if (solution_set_ref(sols, &mut)) return 1;
+            }
+        }
+    return 0;
+}
+
+static unsigned long long verify_rand(unsigned long long* state) { // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+// solves set with both, returns 1 if they differ (diff: the targets reached by only one of them)
+static int verify_game(solver* sv, const gamestate* set, unsigned long long* diff) {
+    solbits ref = { { 0 } };
+    solve(sv, set);
+    solution_set_ref(&ref, set);
+    int differs = 0;
+    for (int i = 0; i < SOLBITS_WORDS; i++) {
+        diff[i] = sv->sols.bits[i] ^ ref.bits[i];
+        differs |= diff[i] != 0;
+    }
+    solbits_count_then_clear(&sv->sols);
+    return differs;
+}
+
+// 1 if a is smaller than b: fewer numbers, then smaller numbers
+static int verify_smaller(const gamestate* a, const gamestate* b) {
+    if (a->size != b->size) return a->size < b->size;
+    for (int i = 0; i < a->size; i++)
+        if (a->val[i] != b->val[i]) return a->val[i] < b->val[i];
+    return 0;
+}
+
+static void print_set(const char* label, const gamestate* set) {
+    printf("%s", label);
+    for (int i = 0; i < set->size; i++) printf("%s%d", i ? "," : " ", set->val[i]);
+}
+
+// returns the amount of games that differ
+size_t verify(size_t start, size_t end, size_t samples, unsigned long long seed) {
+    solver* sv = solver_new();
+    unsigned long long state = seed * 0x9e3779b97f4a7c15ULL + 1, diff[SOLBITS_WORDS];
+    gamestate worst, worst_game;
+    size_t failed = 0;
+    for (size_t g = 0; g < samples; g++) {
+        int larges[4], count[SMALL_MAX + 1] = { 0 }, n = 1 + verify_rand(&state) % 4;
+        gamestate set = { .size = 0 };
+        option_larges(start + verify_rand(&state) % (end - start), larges);
+        for (int i = 0; i < 4; i++) { // n of them, picked at random
+            int k = i + verify_rand(&state) % (4 - i), t = larges[i];
+            larges[i] = larges[k];
+            larges[k] = t;
+        }
+        for (int i = 0; i < n; i++) gs_insert(&set, larges[i]);
+        while (set.size < MAX_SET) {
+            int v = 1 + verify_rand(&state) % SMALL_MAX;
+            if (count[v]++ < 2) gs_insert(&set, v);
+        }
+        if (!verify_game(sv, &set, diff)) continue;
+
+        gamestate shrunk = set;
+        for (int i = 0; i < shrunk.size && shrunk.size > 2; i++) { // leave out numbers while it still differs
+            gamestate less = { .size = 0 };
+            for (int k = 0; k < shrunk.size; k++)
+                if (k != i) less.val[less.size++] = shrunk.val[k];
+            if (verify_game(sv, &less, diff)) {
+                shrunk = less;
+                i = -1;
+            }
+        }
+        if (failed++ == 0 || verify_smaller(&shrunk, &worst)) {
+            worst = shrunk;
+            worst_game = set;
+        }
+    }
+    printf("verified %zu games (seed %llu, %s engine against the plain search): ", samples, seed, engine_names[selected_engine]);
+    if (failed == 0) {
+        printf("all the same\n");
+    } else {
+        printf("%zu differ\n", failed);
+        print_set("smallest:", &worst);
+        print_set(" (from", &worst_game);
+        printf(")\ntargets:");
+        verify_game(sv, &worst, diff);
+        solve(sv, &worst);
+        for (int t = MIN_TARGET; t <= MAX_TARGET; t++)
+            if (diff[(t - MIN_TARGET) >> 6] >> ((t - MIN_TARGET) & 63) & 1)
+                printf(" %c%d", sv->sols.bits[(t - MIN_TARGET) >> 6] >> ((t - MIN_TARGET) & 63) & 1 ? '+' : '-', t);
+        printf(" (+: only the engine reaches it, -: only the plain search)\n");
+    }
+    solver_free(sv);
+    return failed;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [--shard i/N | --range start:end | --larges a,b,c,d] [--threads N] [--procs N] [--affinity policy] [--engine name] [--cache-mb N] [--kernel name] [--no-prune] [--count-expressions] [--dedup] [--checkpoint file] [--store file [--store-games]] [--progress N] [--status file] [--stats]\n       %s --explain a,b,c,d,e,f target\n       %s --serve file [--socket path]\n       %s --verify N [--seed S] [--shard i/N | --range start:end | --larges a,b,c,d] [--engine name] [--kernel name] [--no-prune]\n", prog, prog, prog, prog);
+    fprintf(stderr, "  --shard i/N         compute the i-th (0-based) of N equally sized, contiguous parts of all %d options\n", NUM_OPTIONS);
+    fprintf(stderr, "  --range start:end   compute the options with index start (inclusive) to end (exclusive)\n");
+    fprintf(stderr, "  --larges a,b,c,d    compute a single option, given by its four distinct large numbers (%d..%d)\n", MIN_LARGE, MAX_LARGE);
+    fprintf(stderr, "  --threads N         amount of worker threads (default: amount of online cpus)\n");
+    fprintf(stderr, "  --procs N           compute the options in N worker processes (with --threads each, default: 1)\n");
+    fprintf(stderr, "  --affinity policy   pin the workers to cpus: none, compact (one numa node after the other) or scatter (default: none)\n");
+    fprintf(stderr, "  --engine name       engine computing the targets of a set: search, subset or mitm (default: %s)\n", engine_names[selected_engine]);
+    fprintf(stderr, "  --cache-mb N        size of the subset engine's cache per thread in MiB, 0 disables it (default: %zu)\n", cache_max_bytes >> 20);
+    fprintf(stderr, "  --kernel name       kernel computing the results of all pairs in the search engine: scalar or avx2 (default: %s)\n", kernel_names[kernel_selected()]);
+    fprintf(stderr, "  --no-prune          don't skip redundant branches in the search engine (for comparison, the results are the same)\n");
+    fprintf(stderr, "  --count-expressions with --engine search: also count the expressions reaching a target (implies --no-prune, a lot slower)\n");
+    fprintf(stderr, "  --dedup             compute the sets with 1 to 3 larges once for all options sharing them\n");
+    fprintf(stderr, "  --checkpoint file   append computed options to file, skip the options already in it\n");
+    fprintf(stderr, "  --store file        also write the results to a binary, memory-mappable file\n");
+    fprintf(stderr, "  --store-games       also store the reachable targets of every game (about 20 GB for all options)\n");
+    fprintf(stderr, "  --progress N        report the progress (rates, eta) to stderr every N seconds (also on SIGUSR1)\n");
+    fprintf(stderr, "  --status file       keep file updated with the progress, one 'key value' per line\n");
+    fprintf(stderr, "  --stats             print counters of the work done (needs a build with -DSTATS)\n");
+    fprintf(stderr, "  --explain n,.. t    print how target t is reached from the numbers n (e.g. --explain 25,50,75,100,3,6 952)\n");
+    fprintf(stderr, "  --verify N          compare the targets of N random games with a plain search, report the smallest game that differs\n");
+    fprintf(stderr, "  --seed S            with --verify: seed of the random games (default: 1)\n");
+    fprintf(stderr, "  --serve file        answer queries from the results store file on stdin ('o <option>', 'o a,b,c,d', 'r a,b,c,d,e,f target')\n");
+    fprintf(stderr, "  --socket path       with --serve: answer queries on the unix socket path instead\n");
+    fprintf(stderr, "without arguments, all options are computed.\n");
+}
+
+int main(int argc, char *argv[]) {
+    size_t start = 0, end = NUM_OPTIONS, verify_samples = 0;
+    unsigned long long verify_seed = 1;
+    int show_stats = 0, explain_target = 0;
+    gamestate explain_set = { .size = 0 }; // --explain, if size > 0
+    const char *serve_path = NULL, *socket_path = NULL;
+    long nthreads = 0; // default: one per online cpu, or per worker process with --procs
+    kernel_select(KERNEL_AVX2); // stays scalar if not supported
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--shard") && i + 1 < argc) {
+            size_t shard, shards;
+            if (sscanf(argv[++i], "%zu/%zu", &shard, &shards) != 2 || shards == 0 || shard >= shards) {
+                usage(argv[0]);
+                return 1;
+            }
+            start = NUM_OPTIONS * shard / shards;
+            end = NUM_OPTIONS * (shard + 1) / shards;
+        } else if (!strcmp(argv[i], "--range") && i + 1 < argc) {
+            if (sscanf(argv[++i], "%zu:%zu", &start, &end) != 2 || start > end || end > NUM_OPTIONS) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--larges") && i + 1 < argc) {
+            int larges[4];
+            if (sscanf(argv[++i], "%d,%d,%d,%d", &larges[0], &larges[1], &larges[2], &larges[3]) != 4) {
+                usage(argv[0]);
+                return 1;
+            }
+            for (int j = 1; j < 4; j++) // sort ascending
+                for (int k = j; k > 0 && larges[k - 1] > larges[k]; k--) {
+                    int tmp = larges[k];
+                    larges[k] = larges[k - 1];
+                    larges[k - 1] = tmp;
+                }
+            for (int j = 0; j < 4; j++)
+                if (larges[j] < MIN_LARGE || larges[j] > MAX_LARGE || (j > 0 && larges[j] == larges[j - 1])) {
+                    usage(argv[0]);
+                    return 1;
+                }
+            start = option_index(larges);
+            end = start + 1;
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            nthreads = atol(argv[++i]);
+            if (nthreads < 1) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--procs") && i + 1 < argc) {
+            nprocs = atoi(argv[++i]);
+            if (nprocs < 1) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--progress") && i + 1 < argc) {
+            progress_seconds = atoi(argv[++i]);
+            if (progress_seconds < 1) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--status") && i + 1 < argc) {
+            status_path = argv[++i];
+        } else if (!strcmp(argv[i], "--affinity") && i + 1 < argc) {
+            const char* name = argv[++i];
+            selected_placement = NUM_PLACEMENTS;
+            for (int k = 0; k < NUM_PLACEMENTS; k++)
+                if (!strcmp(name, placement_names[k])) selected_placement = k;
+            if (selected_placement == NUM_PLACEMENTS) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (!strcmp(argv[i], "--store") && i + 1 < argc) {
+            store_path = argv[++i];
+        } else if (!strcmp(argv[i], "--explain") && i + 2 < argc) {
+            for (char* num = strtok(argv[++i], ","); num != NULL; num = strtok(NULL, ","))
+                if (explain_set.size < MAX_SET && atoi(num) > 0) gs_insert(&explain_set, atoi(num));
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+            explain_target = atoi(argv[++i]);
+            if (explain_set.size == 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--verify") && i + 1 < argc) {
+            verify_samples = atol(argv[++i]);
+            if (verify_samples < 1) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            verify_seed = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--serve") && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (!strcmp(argv[i], "--socket") && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (!strcmp(argv[i], "--stats")) {
+#ifndef STATS
+            fprintf(stderr, "--stats needs a build with -DSTATS\n");
+            return 1;
+#endif
+            show_stats = 1;
+        } else if (!strcmp(argv[i], "--store-games")) {
+            store_games = 1;
+        } else if (!strcmp(argv[i], "--dedup")) {
+            dedup = 1;
+        } else if (!strcmp(argv[i], "--no-prune")) {
+            search_prune = 0;
+        } else if (!strcmp(argv[i], "--count-expressions")) {
+            count_expressions = 1;
+        } else if (!strcmp(argv[i], "--cache-mb") && i + 1 < argc) {
+            long mb = atol(argv[++i]);
+            if (mb < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            cache_max_bytes = (size_t)mb << 20;
+        } else if (!strcmp(argv[i], "--kernel") && i + 1 < argc) {
+            const char* name = argv[++i];
+            int k = 0;
+            while (k < NUM_KERNELS && strcmp(name, kernel_names[k])) k++;
+            if (k == NUM_KERNELS) {
+                usage(argv[0]);
+                return 1;
+            }
+            if (!kernel_select(k)) {
+                fprintf(stderr, "the %s kernel is not supported by this cpu\n", name);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--engine") && i + 1 < argc) {
+            const char* name = argv[++i];
+            selected_engine = NUM_ENGINES;
+            for (int e = 0; e < NUM_ENGINES; e++)
+                if (!strcmp(name, engine_names[e])) selected_engine = e;
+            if (selected_engine == NUM_ENGINES) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if ((store_games && store_path == NULL) || (socket_path != NULL && serve_path == NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (count_expressions && (selected_engine != ENGINE_SEARCH || dedup || checkpoint_path != NULL)) {
+        fprintf(stderr, "--count-expressions needs --engine search and can't be combined with --dedup or --checkpoint\n");
+        return 1;
+    }
+    if (start == end && serve_path == NULL && explain_set.size == 0) { // --range a:a, or more shards than options
+        fprintf(stderr, "the range of options is empty\n");
+        return 1;
+    }
+    if (count_expressions) search_prune = 0; // pruned branches are expressions as well, before leaves_init
+    if (serve_path != NULL) {
+        store* st = store_open(serve_path);
+        games_init();
+        game_index_init();
+        if (socket_path != NULL) serve_socket(st, socket_path);
+        else serve_fd(st, 0, 1);
+        return 0;
+    }
+    if (explain_set.size > 0) {
+        char expr[256];
+        solver* sv = solver_new();
+        if (explain(sv, &explain_set, explain_target, expr, sizeof(expr)) < 0) printf("%d can't be reached\n", explain_target);
+        else printf("%d = %s\n", explain_target, expr);
+        solver_free(sv);
+        return 0;
+    }
+
+    if (nthreads == 0) nthreads = nprocs > 1 ? 1 : sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+    leaves_init(); // after --no-prune
+    games_init();
+    if (verify_samples > 0) return verify(start, end, verify_samples, verify_seed) > 0;
+    double wstart = wall_time(), cstart = cpu_time();
+    iterate_sets(start, end, nthreads);
+    if (nprocs > 1)
+        printf("took %.3fs to compute (%.3fs cpu time, %d processes, %ld threads each, %s engine)\n", wall_time() - wstart, cpu_time() - cstart, nprocs, nthreads, engine_names[selected_engine]);
+    else
+        printf("took %.3fs to compute (%.3fs cpu time, %ld threads, %s engine)\n", wall_time() - wstart, cpu_time() - cstart, nthreads, engine_names[selected_engine]);
+    if (show_stats) STAT(stats_print());
     return 0;
 }